@@ -8,13 +8,14 @@
 // This is used before expensive SAT collision checking.
 
 // Contracts:
-// - getAABB() requires Body.transformedVertices to be up-to-date (world space).
+// - getAABB() requires the body's transformedVertices to be up-to-date (world space).
+// - Circles have no vertices, physEng::worldBounds() bounds them from their radius instead.
+// - BodyStore caches each body's AABB in bodies.bounds, refreshed by the broadphase.
 // - AABBintersection() treats touching edges as intersection.
 // -------
 
 #pragma once
 #include "core/Vector2.hpp"
-#include "core/RigidBody.hpp"
 
 struct AABB{ 
     Vec2 min;
@@ -22,19 +23,21 @@ struct AABB{
 };
 
 // Computes an AABB around a body's cached world-space vertices.
-AABB getAABB(const RigidBody& Body){
+inline AABB getAABB(const Vec2* vertices, int count){
 
     // -- 
     // Returns an AABB bounding box for a polygon
-    // param Body - The polygon to create a bounding box for ( DOES NOT TAKE OWNERSHIP ) 
+    // param vertices - The polygon's world-space vertices to create a bounding box for ( DOES NOT TAKE OWNERSHIP ) 
+    // param count - Number of vertices, must be at least 1
     // This is assuming that the polygon has had it's transformed vertices calculated already.
     // -- 
 
-    const Vec2& first = Body.transformedVertices[0];
+    const Vec2& first = vertices[0];
     Vec2 min = first;
     Vec2 max = first;
 
-    for (auto& v : Body.transformedVertices){
+    for (int k = 1; k < count; ++k){
+        const Vec2& v = vertices[k];
         if (v.x < min.x) min.x = v.x;
         if (v.y < min.y) min.y = v.y;
         if (v.x > max.x) max.x = v.x;
@@ -51,7 +54,7 @@ AABB getAABB(const RigidBody& Body){
 }
 
 // Returns true if two AABBs overlap (including touching edges)
-bool AABBintersection(const AABB& a, const AABB& b) {
+inline bool AABBintersection(const AABB& a, const AABB& b) {
 
     // Separating axis tests for axis-aligned boxes.
     if (a.max.x < b.min.x || b.max.x < a.min.x) return false;
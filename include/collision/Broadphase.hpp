@@ -0,0 +1,88 @@
+// Broadphase.hpp, created by Andrew Gossen.
+
+// -----
+// Common interface of the broadphase backends, which find the candidate pairs the narrowphase tests.
+
+// Backends:
+// - GridBroadphase, a self-tuning hierarchical grid, rebuilt from scratch every step ( see Partitioning.hpp ).
+// - TreeBroadphase, a persistent dynamic AABB tree updated incrementally ( see DynamicTree.hpp ).
+// - SweepAndPrune, persistent sorted endpoint arrays updated by insertion sort ( see SweepAndPrune.hpp ).
+// The World owns one backend, selected with World::setBroadphase().
+
+// Contract of findPairs():
+// - proxies lists the dense indices of the bodies taking part this step ( awake dynamic bodies ), and
+//   bodies.bounds is up-to-date for every one of them. Static bodies live in the World's baked StaticGrid instead.
+// - Returns pairs of dense body indices, each unordered pair at most once. A pair is only a candidate, its
+//   AABBs may not overlap, but every pair whose AABBs do overlap must be returned.
+// - Bodies missing from proxies ( asleep, static or removed ) must not be returned, even if a backend still
+//   remembers them from earlier steps.
+// - All returned and scratch memory comes from arena. Persistent backend state may use the heap, but should
+//   stop allocating once warm.
+
+// Thread Safety:
+// - findPairs() is called from the physics thread only, backends may spread work over jobs.
+// -----
+
+#pragma once
+#include "core/BodyStore.hpp"
+#include "collision/Partitioning.hpp"
+#include "memory/FrameArena.hpp"
+#include "jobs/JobSystem.hpp"
+#include "stats/world_stats.hpp"
+
+namespace partioning {
+
+class Broadphase{
+
+    public:
+
+    virtual ~Broadphase() = default;
+
+    // dt is the step about to be simulated, backends may use it to predict motion
+    virtual PairList findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                               JobSystem& jobs, FrameArena& arena) = 0;
+
+    // Writes backend specific statistics of the most recent findPairs() call
+    virtual void reportStats(WorldStats& stats) const { (void)stats; }
+
+    // Level 0 cell size the World's static and sleeping grids should share, 0 for backends without cells
+    virtual float cellSize() const { return 0.0f; }
+
+};
+
+class GridBroadphase : public Broadphase{
+
+    // Hierarchical grid ( see buildPairsFromLevels() ), rebuilt from scratch every step, with its cell size tuned
+    // from the bodies it sees:
+    // - The base cell size follows the median body extent, times a scale kept between kMinCellScale and kMaxCellScale.
+    // - The scale shrinks while occupied cells hold many bodies on average, and recovers once they hold few. It never
+    //   grows past its default, larger cells save few records but cost many more candidate pairs.
+    // - The base only changes once the target drifts more than kRetuneThreshold from it, so it does not jitter.
+
+    public:
+
+    explicit GridBroadphase(const GridConfig& config) : m_cellSize(config.cellSize) {}
+
+    PairList findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                       JobSystem& jobs, FrameArena& arena) override;
+    void reportStats(WorldStats& stats) const override;
+
+    float cellSize() const override { return m_cellSize; } // Current base ( level 0 ) cell size
+
+    private:
+
+    static constexpr int kSpanGrain = 256;
+    static constexpr float kMinCellScale = 1.0f;
+    static constexpr float kMaxCellScale = 2.0f;
+    static constexpr float kRetuneThreshold = 0.25f;
+    static constexpr float kCrowdedOccupancy = 6.0f; // Mean bodies per occupied cell above which the scale shrinks
+    static constexpr float kSparseOccupancy = 1.5f; // ... and below which it grows
+
+    float m_cellSize;
+    float m_cellScale{kMaxCellScale};
+    int m_levels{0};
+    uint64_t m_occupancy[kOccupancyBuckets]{}; // Of the most recent step
+
+};
+
+} // namespace partioning
@@ -5,34 +5,64 @@
 // Collision detection data structures and narrow-phase queries.
 
 // Ownership & Lifetime:
-// - Manifold stores NON-owning references to two RigidBody instances in collision with each other.
-// - The referenced bodies must outlive the Manifold.
-// - Manifold is intended to be short-lived and used within a single
-//   world step.
+// - Manifold stores the BodyStore indices of two bodies in collision with each other.
+// - The indices are only valid while the store is not modified, so Manifold is intended
+//   to be short-lived and used within a single world step.
 
 //  Conventions:
 // - The normal is guaranteed to point from A -> B and is unit length
-// - penetration is the overlap depth along normal (>= 0 when colliding).
+// - penetration is the overlap depth along normal (>= 0 when colliding). Queries given a margin also report
+//   speculative contacts of pairs apart by up to margin, whose penetration is negative ( down to -margin ).
 // - 0 <= contactCount <= 2 
 // -----
 
 #pragma once 
-#include "core/RigidBody.hpp"
+#include "core/BodyStore.hpp"
 #include "core/Vector2.hpp"
+#include "memory/FrameArena.hpp"
 #include <vector>
 
 struct Manifold{ 
-    RigidBody& A;
-    RigidBody& B;
+    int A; // Index of body A in the BodyStore
+    int B; // Index of body B in the BodyStore
     Vec2 normal{0.0f,0.0f}; // Normal pointing from A to B 
     Vec2 contact1{0.0f,0.0f};
     Vec2 contact2{0.0f,0.0f};
     int contactCount{0};
     float penetration{0.0f};
     bool inCollision{false};
+    float contactPenetration[2]{0.0f, 0.0f}; // Overlap at contact1 / contact2 along normal, below penetration at a tilted contact's shallow end
 };
 
-// Narrow-phase SAT collision test between two rigid bodies.
-// Returns a Manifold containing contact data when colliding.
-Manifold SATCollision(RigidBody& RigidBodyA,RigidBody& RigidBodyB);  
+// The face whose normal separated a polygon pair, so the pair can test it first the next time ( e.g. next step ).
+// Bodies that stay apart usually stay apart along the same axis, so this is most often a single projection.
+struct SeparatingAxis{
+    int face{-1}; // Index into the owning shape's normals, -1 when there is none
+    bool onB{false}; // The face belongs to B rather than A
+};
+
+// Narrow-phase entry point, dispatches on the two shapes' ShapeKinds through a compile-time matrix of kernels:
+// circle-circle, circle-polygon, box-box ( OBB, 2 + 2 axes ), fully unrolled SAT for polygons of up to
+// kMaxFixedVertices vertices, GJKCollision() when either polygon is a Hull, and SATCollision() for anything else.
+// When axis is given and names a face, that face is tested first and the pair exits if it still separates.
+// On return axis holds the separating axis of a polygon pair that was found apart, otherwise it has no face.
+// margin is the speculative distance: pairs apart by less than it are still reported, with their closest features
+// as contacts ( see the conventions above ). Every kernel below takes it the same way.
+Manifold collide(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis = nullptr,float margin = 0.0f);
+
+// Narrow-phase SAT collision test between two polygon ( or box ) bodies in the store.
+// Returns a Manifold containing contact data when colliding. The contacts are found by clipping the incident
+// face against the reference face ( the face that owns the SAT axis ), without allocating.
+// arena provides scratch memory to kernels that need it. axis, when given, receives the separating axis as in collide().
+Manifold SATCollision(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis = nullptr,float margin = 0.0f);
+
+// GJK / EPA test between two polygons, for polygons with many vertices. Support points are found by hill climbing
+// each polygon's vertex ring, so the cost grows with the log of the vertex counts. Same Manifold as SATCollision().
+// The EPA polytope is scratch memory from arena.
+Manifold GJKCollision(const BodyStore& bodies,int A,int B,FrameArena& arena,float margin = 0.0f);
+
+// Closed-form tests involving circles, each producing at most one contact point.
+// CirclePolygonCollision accepts either order ( the circle may be A or B ), the normal still points A -> B.
+Manifold CircleCollision(const BodyStore& bodies,int A,int B,float margin = 0.0f);
+Manifold CirclePolygonCollision(const BodyStore& bodies,int A,int B,float margin = 0.0f);
 
@@ -0,0 +1,116 @@
+// DynamicTree.hpp, created by Andrew Gossen.
+
+// -----
+// Dynamic AABB tree, and the broadphase backend built on it.
+
+// DynamicTree:
+// - A binary tree of AABBs, leaves hold the caller's proxies and every internal node bounds its two children.
+// - Leaves are inserted next to the sibling that grows the tree's total perimeter the least, and the tree is
+//   kept height balanced by rotations on the way back up, so queries stay O(log n) for well spread proxies.
+// - Nodes live in one vector with a free list, so proxy ids are stable and steady-state use does not allocate.
+
+// TreeBroadphase:
+// - Each body's leaf stores a fattened AABB: its bounds grown by kTreeMargin, and stretched along the body's
+//   predicted motion for the step. A body is only reinserted once its bounds leave that fat box.
+// - Candidate pairs persist between steps, keyed by slot pair. Only bodies that were reinserted query the tree,
+//   so a step costs O(moved * log n) plus a linear pass over the persistent pairs, instead of a full rebuild.
+// - Pairs stay candidates while their fat boxes overlap, so more pairs are returned than a grid would return.
+//   The narrowphase's AABB test culls them.
+// - Sizes never enter into it, so a large body is one leaf rather than many grid cells.
+
+// Thread Safety:
+// - NOT thread-safe, used from the physics thread only.
+// -----
+
+#pragma once
+#include "collision/AABB.hpp"
+#include "collision/Broadphase.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace partioning {
+
+class DynamicTree{
+
+    public:
+
+    static constexpr int kNull = -1;
+
+    int createProxy(const AABB& box, uint32_t user); // Returns the proxy id
+    void destroyProxy(int proxy);
+
+    const AABB& fatAABB(int proxy) const { return m_nodes[proxy].box; }
+    uint32_t userData(int proxy) const { return m_nodes[proxy].user; }
+    int height() const { return (m_root == kNull) ? 0 : m_nodes[m_root].height; }
+
+    // Calls callback(proxy) for every proxy whose box overlaps box
+    template<typename F>
+    void query(const AABB& box, F&& callback) {
+
+        if (m_root == kNull) return;
+
+        m_stack.clear();
+        m_stack.push_back(m_root);
+        while (!m_stack.empty()) {
+            const int id = m_stack.back();
+            m_stack.pop_back();
+            const Node& node = m_nodes[id];
+            if (!AABBintersection(node.box, box)) continue;
+            if (node.isLeaf()) {
+                callback(id);
+            } else {
+                m_stack.push_back(node.child1);
+                m_stack.push_back(node.child2);
+            }
+        }
+
+    }
+
+    private:
+
+    struct Node{
+        AABB box;
+        int parent{kNull}; // Next free node while on the free list
+        int child1{kNull};
+        int child2{kNull};
+        int height{0}; // Leaves are 0, free nodes -1
+        uint32_t user{0};
+
+        bool isLeaf() const { return child1 == kNull; }
+    };
+
+    std::vector<Node> m_nodes;
+    int m_root{kNull};
+    int m_free{kNull};
+    std::vector<int> m_stack; // Query traversal stack, reused
+
+    int allocateNode();
+    void freeNode(int id);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int id); // Rebalances and refits from id up to the root
+    int balance(int id); // Rotates the subtree at id if unbalanced, returns the subtree's new root
+
+};
+
+class TreeBroadphase : public Broadphase{
+
+    public:
+
+    PairList findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                       JobSystem& jobs, FrameArena& arena) override;
+
+    private:
+
+    DynamicTree m_tree;
+    std::vector<int> m_leafOfSlot; // Tree proxy of each body slot, or kNull
+    std::vector<uint32_t> m_seen; // Step stamp of the last step each slot was a proxy
+    std::vector<uint32_t> m_moved; // Step stamp of the last step each slot was reinserted
+    std::vector<uint32_t> m_movedSlots; // Slots reinserted this step
+    std::vector<uint64_t> m_pairs; // Persistent candidate pairs, slot pair keys, sorted
+    std::vector<uint64_t> m_nextPairs; // Next step's m_pairs, swapped in so both keep their capacity
+    uint32_t m_stamp{0};
+
+};
+
+} // namespace partioning
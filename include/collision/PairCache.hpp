@@ -0,0 +1,76 @@
+// PairCache.hpp, created by Andrew Gossen.
+
+// -----
+// Persistent per-pair data carried from one step to the next ( e.g. accumulated contact impulses ).
+
+// Keys are body-pair keys from partioning::pairKey(), built from BodyStore slots ( not dense indices )
+// so they survive bodies being added, removed or reordered.
+
+// Usage, once per step:
+// - find(key) looks up what was stored for the pair during the previous step.
+// - store(key, value) records the pair's data for the next step.
+// - flip() makes the stored entries current, pairs not stored this step are dropped.
+// A removed body's slot is recycled by the next body added, so its pairs must be evict()ed before the next find().
+
+// Storage is a pair of sorted vectors swapped every step, so lookups are binary searches, iteration
+// order is deterministic, and steady-state stepping does not allocate.
+// -----
+
+#pragma once
+#include "core/Vector2.hpp"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+template<typename T>
+class PairCache{
+
+    public:
+
+    const T* find(uint64_t key) const {
+        auto it = std::lower_bound(m_current.begin(), m_current.end(), key,
+                                   [](const Entry& e, uint64_t k) { return e.key < k; });
+        if (it == m_current.end() || it->key != key) return nullptr;
+        return &it->value;
+    }
+
+    void store(uint64_t key, const T& value) { m_next.push_back(Entry{ key, value }); }
+
+    void flip() {
+        std::sort(m_next.begin(), m_next.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+        m_current.swap(m_next);
+        m_next.clear();
+    }
+
+    // Drops the previous step's entries whose key pred(key) accepts
+    template<typename Pred>
+    void evict(Pred pred) {
+        m_current.erase(std::remove_if(m_current.begin(), m_current.end(), [&](const Entry& e) { return pred(e.key); }), m_current.end());
+    }
+
+    void clear() { m_current.clear(); m_next.clear(); }
+    int size() const { return static_cast<int>(m_current.size()); }
+
+    private:
+
+    struct Entry{
+        uint64_t key;
+        T value;
+    };
+
+    std::vector<Entry> m_current; // Previous step's entries, sorted by key
+    std::vector<Entry> m_next; // Entries being stored this step
+
+};
+
+// Accumulated impulses of one contact point, used to warm start the solver on the next step
+struct CachedContact{
+    Vec2 anchor; // Contact point in the local frame of the pair's lower-slot body, used to match contacts across steps
+    float normalImpulse{0.0f};
+    float tangentImpulse{0.0f};
+};
+
+struct CachedManifold{
+    CachedContact contacts[2];
+    int contactCount{0};
+};
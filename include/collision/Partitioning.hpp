@@ -1,14 +1,15 @@
 // Partitioning.hpp
-// This is a basic uniform-grid spatial hashing, used to find narrow-phase candidates.
+// Grid spatial partitioning ( flat hierarchical grid levels, and the persistent static and sleeping grids ), used to find narrow-phase candidates.
 
 #pragma once
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
+#include <limits>
 #include <utility>
 #include <cstdint>
 #include <cmath>
 #include "collision/AABB.hpp" 
+#include "memory/FrameArena.hpp"
 
 namespace partioning {
 
@@ -31,60 +32,310 @@ inline int cellCoord(float x, float cellSize) {
     return static_cast<int>(std::floor(x / cellSize));
 }
 
-inline std::vector<std::pair<int,int>> buildPairsFromAABBs(const std::vector<AABB>& aabbs, const GridConfig& cfg) {
+// Inclusive range of grid cells overlapped by an AABB
+struct CellSpan {
+    int x0, y0;
+    int x1, y1;
+};
+
+inline CellSpan cellSpan(const AABB& b, const GridConfig& cfg) {
+    return { cellCoord(b.min.x, cfg.cellSize), cellCoord(b.min.y, cfg.cellSize),
+             cellCoord(b.max.x, cfg.cellSize), cellCoord(b.max.y, cfg.cellSize) };
+}
 
-    // Build candidate pairs from AABBs using a spatial hash grid.
-    // Returns pairs of indices (i,j) into bodies/AABB arrays.
+using PairList = FrameVector<std::pair<int,int>>;
+
+constexpr int kOccupancyBuckets = 8; // Occupancy histogram bucket k counts cells holding [2^k, 2^(k+1)) bodies, the last is open-ended
+
+inline int occupancyBucket(size_t bodies) {
+    int k = 0;
+    while (bodies > 1 && k < kOccupancyBuckets - 1) { bodies >>= 1; ++k; }
+    return k;
+}
 
-    std::unordered_map<uint64_t, std::vector<int>> buckets;
-    buckets.reserve(aabbs.size() * 2);
+// One level of a flat grid: a ( cell, index ) record per cell each member's span covers, radix sorted by cell,
+// so the members sharing a cell form one contiguous run ( in member order, the sort is stable ).
+// Cells are compacted to row-major indices relative to the lowest occupied cell. Lives in the frame arena.
+struct FlatGridLevel {
 
-    // Insert indices into buckets
-    for (int i = 0; i < (int)aabbs.size(); ++i) {
-        const AABB& b = aabbs[i];
+    struct Record {
+        uint64_t cell;
+        int index;
+    };
 
-        // Compute grid-cell range overlapped by this AABB
-        int x0 = cellCoord(b.min.x, cfg.cellSize);
-        int x1 = cellCoord(b.max.x, cfg.cellSize);
-        int y0 = cellCoord(b.min.y, cfg.cellSize);
-        int y1 = cellCoord(b.max.y, cfg.cellSize);
+    int minX{0}, minY{0}, maxX{-1}, maxY{-1}; // Occupied cell range
+    uint64_t width{0};
+    FrameVector<Record> records;
 
-        for (int cy = y0; cy <= y1; ++cy) {
-            for (int cx = x0; cx <= x1; ++cx) {
-                buckets[cellKey(cx, cy)].push_back(i);
+    explicit FlatGridLevel(FrameArena& arena) : records(ArenaAllocator<Record>(arena)) {}
+
+    uint64_t compact(int cx, int cy) const { return uint64_t(int64_t(cy) - minY) * width + uint64_t(int64_t(cx) - minX); }
+
+    // members lists indices into spans, in the order runs should list them
+    template<typename Members>
+    void build(const FrameVector<CellSpan>& spans, const Members& members, FrameArena& arena) {
+
+        records.clear();
+        if (members.empty()) return;
+
+        minX = minY = std::numeric_limits<int>::max();
+        maxX = maxY = std::numeric_limits<int>::min();
+        size_t recordCount = 0;
+        for (int i : members) {
+            const CellSpan& span = spans[i];
+            minX = std::min(minX, span.x0);
+            minY = std::min(minY, span.y0);
+            maxX = std::max(maxX, span.x1);
+            maxY = std::max(maxY, span.y1);
+            recordCount += size_t(span.x1 - span.x0 + 1) * size_t(span.y1 - span.y0 + 1);
+        }
+        width = uint64_t(int64_t(maxX) - minX + 1);
+
+        records.reserve(recordCount);
+        for (int i : members) {
+            const CellSpan& span = spans[i];
+            for (int cy = span.y0; cy <= span.y1; ++cy) {
+                const uint64_t row = compact(span.x0, cy);
+                for (int cx = span.x0; cx <= span.x1; ++cx) records.push_back({ row + uint64_t(cx - span.x0), i });
             }
         }
+
+        // -- LSD radix sort, 8 bits per pass, only over the bytes the largest cell index uses
+
+        const uint64_t maxCell = compact(maxX, maxY);
+        FrameVector<Record> sorted(records.size(), Record{}, ArenaAllocator<Record>(arena));
+        for (int shift = 0; shift < 64 && (maxCell >> shift) != 0; shift += 8) {
+            size_t offsets[256] = {};
+            for (const Record& r : records) offsets[(r.cell >> shift) & 0xFF]++;
+            size_t sum = 0;
+            for (size_t& o : offsets) { const size_t n = o; o = sum; sum += n; }
+            for (const Record& r : records) sorted[offsets[(r.cell >> shift) & 0xFF]++] = r;
+            records.swap(sorted);
+        }
+
     }
 
-    // Generate unique pairs within each bucket
-    std::unordered_set<uint64_t> seen;
-    seen.reserve(aabbs.size() * 8);
+    // Calls f(begin, end, cx, cy) for the run of records of every occupied cell
+    template<typename F>
+    void forEachRun(F&& f) const {
+        const size_t total = records.size();
+        for (size_t begin = 0; begin < total; ) {
+            size_t end = begin + 1;
+            while (end < total && records[end].cell == records[begin].cell) ++end;
+            f(begin, end, minX + static_cast<int>(records[begin].cell % width), minY + static_cast<int>(records[begin].cell / width));
+            begin = end;
+        }
+    }
 
-    std::vector<std::pair<int,int>> pairs;
-    pairs.reserve(aabbs.size() * 4);
+    // Range of records in cell ( cx, cy ), empty if the cell is unoccupied
+    std::pair<size_t, size_t> findRun(int cx, int cy) const {
+        if (cx < minX || cx > maxX || cy < minY || cy > maxY) return { 0, 0 };
+        const uint64_t cell = compact(cx, cy);
+        auto first = std::lower_bound(records.begin(), records.end(), cell, [](const Record& r, uint64_t c) { return r.cell < c; });
+        auto last = first;
+        while (last != records.end() && last->cell == cell) ++last;
+        return { size_t(first - records.begin()), size_t(last - records.begin()) };
+    }
 
-    for (auto& [key, ids] : buckets) {  // Iterate over each occupied grid cell
-       
-        if (ids.size() < 2) continue;
+};
 
-        for (size_t a = 0; a < ids.size(); ++a) { // Generate all unique pairs within this cell
-            for (size_t b = a + 1; b < ids.size(); ++b) {
-                int i = ids[a];
-                int j = ids[b];
+// Owner cell of a pair sharing cells, the minimum corner of the two spans' overlap. A pair is only emitted by its owner
+// cell, so pairs spanning several shared cells need no dedup set.
+inline bool ownsPair(const CellSpan& a, const CellSpan& b, int cx, int cy) {
+    return std::max(a.x0, b.x0) == cx && std::max(a.y0, b.y0) == cy;
+}
 
-                // Create unique order-independent pair key
-                uint64_t pk = pairKey(i, j);
-                if (seen.insert(pk).second) {
-                    // Only emit pair once across all cells
-                    pairs.push_back({i, j});
-                }
-                
+// Appends the pairs within each cell of level, and counts its cells into occupancy ( if given )
+inline void emitLevelPairs(const FlatGridLevel& level, const FrameVector<CellSpan>& spans, PairList& pairs, uint64_t* occupancy) {
+    level.forEachRun([&](size_t begin, size_t end, int cx, int cy) {
+        if (occupancy) occupancy[occupancyBucket(end - begin)]++;
+        for (size_t a = begin; a < end; ++a) {
+            const int i = level.records[a].index;
+            for (size_t b = a + 1; b < end; ++b) {
+                const int j = level.records[b].index;
+                if (ownsPair(spans[i], spans[j], cx, cy)) pairs.push_back({i, j});
             }
         }
+    });
+}
+
+// Hierarchical grid, level k has cells of baseCellSize * 2^k and every body is bucketed in one level only, the first
+// whose cells are at least as large as the body. So no body spans more than 2 x 2 cells of its level, small bodies
+// never share a crowded coarse cell, and large bodies never fan out into hundreds of fine ones.
+constexpr int kMaxGridLevels = 8;
+
+struct GridLevels {
+    float baseCellSize;
+    int count; // Levels in use, at most kMaxGridLevels
+};
+
+// Level and cell span of a body with bounds b
+inline int gridLevel(const AABB& b, const GridLevels& grid) {
+    const float extent = std::max(b.max.x - b.min.x, b.max.y - b.min.y);
+    int level = 0;
+    float size = grid.baseCellSize;
+    while (extent > size && level < kMaxGridLevels - 1) { size *= 2.0f; ++level; }
+    return level;
+}
+
+inline CellSpan cellSpan(const AABB& b, const GridLevels& grid, int level) {
+    return cellSpan(b, GridConfig{ grid.baseCellSize * float(1 << level) });
+}
+
+inline PairList buildPairsFromLevels(const FrameVector<AABB>& aabbs, const FrameVector<int>& levels,
+                                     const FrameVector<CellSpan>& spans, const GridLevels& grid,
+                                     FrameArena& arena, uint64_t* occupancy) {
+
+    // Build candidate pairs from a hierarchical grid.
+    // levels[i] and spans[i] ( the span at that level ) are precomputed per body, callers may do so in parallel.
+    // Returns pairs of indices (i,j) into the arrays, each pair once. occupancy ( kOccupancyBuckets, may be null )
+    // accumulates the occupied cells of every level by body count.
+
+    // - Same level pairs come from each level's cell runs ( see emitLevelPairs() )
+    // - Across levels, each body looks up the cells it covers in every coarser level ( 1 or 2 per axis, as it is
+    //   smaller than those cells ) and pairs with their members, again only in the pair's owner cell
+
+    PairList pairs{ArenaAllocator<std::pair<int,int>>(arena)};
+    const int count = static_cast<int>(aabbs.size());
+    if (count < 2) return pairs;
+
+    // -- Members of each level, in index order
+
+    FrameVector<FrameVector<int>> members{ArenaAllocator<FrameVector<int>>(arena)};
+    members.reserve(grid.count);
+    for (int l = 0; l < grid.count; ++l) members.emplace_back(ArenaAllocator<int>(arena));
+    for (int i = 0; i < count; ++i) members[levels[i]].push_back(i);
+
+    FrameVector<FlatGridLevel> grids{ArenaAllocator<FlatGridLevel>(arena)};
+    grids.reserve(grid.count);
+    for (int l = 0; l < grid.count; ++l) {
+        grids.emplace_back(arena);
+        grids[l].build(spans, members[l], arena);
+    }
+
+    pairs.reserve(count * 4);
+    for (int l = 0; l < grid.count; ++l) emitLevelPairs(grids[l], spans, pairs, occupancy);
+
+    // -- Across levels
+
+    for (int i = 0; i < count; ++i) {
+        for (int l = levels[i] + 1; l < grid.count; ++l) {
+
+            if (grids[l].records.empty()) continue;
 
+            const CellSpan span = cellSpan(aabbs[i], grid, l);
+            for (int cy = span.y0; cy <= span.y1; ++cy) {
+                for (int cx = span.x0; cx <= span.x1; ++cx) {
+                    const auto [begin, end] = grids[l].findRun(cx, cy);
+                    for (size_t r = begin; r < end; ++r) {
+                        const int j = grids[l].records[r].index;
+                        if (ownsPair(span, spans[j], cx, cy)) pairs.push_back({i, j});
+                    }
+                }
+            }
+
+        }
     }
 
-    return pairs; // Returns canditate pairs for narrow testing 
+    return pairs;
+
 }
 
+// Persistent grid of bodies whose AABBs do not change between steps ( static and sleeping bodies ).
+// Built only when its contents change, then queried by the bodies that do move, so these bodies are never
+// re-inserted and pairs among them are never generated.
+// Hierarchical like the broadphase grid ( see GridLevels ): each body is bucketed in the first level whose cells
+// are at least its size, so a floor much larger than the cells sits in a coarse level instead of fanning out over
+// the fine ones. Each level's cells are stored flat: sorted cell keys, each with a range of the id array, so a
+// query is a binary search per covered column, and a rebuild reuses the arrays' capacity instead of allocating.
+// Stores caller-defined ids ( e.g. BodyStore slots ), as dense indices may change between rebuilds.
+struct BakedGrid {
+
+    struct Level {
+        std::vector<std::pair<uint64_t, uint32_t>> records; // ( cell, id ) staged by insert(), until bake()
+        std::vector<uint64_t> cells; // Sorted, unique
+        std::vector<uint32_t> starts; // Ids of cells[c] are ids[starts[c]] .. ids[starts[c + 1]]
+        std::vector<uint32_t> ids;
+    };
+
+    GridLevels grid{ GridConfig{}.cellSize, 0 }; // count is the number of levels holding bodies
+    Level levels[kMaxGridLevels];
+
+    // cellKey() with the row's sign bit flipped, so a column's cells sort by row even across negative rows
+    static uint64_t key(int cx, int cy) { return cellKey(cx, cy) ^ 0x80000000u; }
+
+    void clear(float baseCellSize) { // Empties the grid, later inserts use baseCellSize for level 0
+        for (Level& level : levels) { level.records.clear(); level.cells.clear(); level.starts.clear(); level.ids.clear(); }
+        grid = GridLevels{ baseCellSize, 0 };
+    }
+    bool empty() const { return grid.count == 0; }
+
+    void insert(const AABB& b, uint32_t id) {
+
+        const int level = gridLevel(b, grid);
+        const CellSpan span = cellSpan(b, grid, level);
+        grid.count = std::max(grid.count, level + 1);
+
+        for (int cy = span.y0; cy <= span.y1; ++cy) {
+            for (int cx = span.x0; cx <= span.x1; ++cx) {
+                levels[level].records.push_back({ key(cx, cy), id });
+            }
+        }
+
+    }
+
+    // Sorts the staged records into the flat cell layout, call once after the inserts
+    void bake() {
+
+        for (Level& level : levels) {
+
+            std::sort(level.records.begin(), level.records.end());
+            level.cells.clear();
+            level.starts.clear();
+            level.ids.clear();
+            level.ids.reserve(level.records.size());
+
+            for (const auto& [cell, id] : level.records) {
+                if (level.cells.empty() || level.cells.back() != cell) {
+                    level.cells.push_back(cell);
+                    level.starts.push_back(static_cast<uint32_t>(level.ids.size()));
+                }
+                level.ids.push_back(id);
+            }
+            level.starts.push_back(static_cast<uint32_t>(level.ids.size()));
+
+            level.records.clear();
+
+        }
+
+    }
+
+    // Appends the ids sharing a cell with b to out. An id can appear more than once when it spans several cells.
+    template<typename Out>
+    void query(const AABB& b, Out& out) const {
+
+        for (int l = 0; l < grid.count; ++l) {
+
+            const Level& level = levels[l];
+            if (level.cells.empty()) continue;
+            const CellSpan span = cellSpan(b, grid, l);
+
+            for (int cx = span.x0; cx <= span.x1; ++cx) { // Keys sort by column, then row, so each column is one search
+                const uint64_t last = key(cx, span.y1);
+                auto it = std::lower_bound(level.cells.begin(), level.cells.end(), key(cx, span.y0));
+                for (; it != level.cells.end() && *it <= last; ++it) {
+                    const size_t c = static_cast<size_t>(it - level.cells.begin());
+                    out.insert(out.end(), level.ids.begin() + level.starts[c], level.ids.begin() + level.starts[c + 1]);
+                }
+            }
+
+        }
+
+    }
+
+};
+
+using StaticGrid = BakedGrid; // Static bodies, rebuilt when statics are added, removed or moved
+using RestingGrid = BakedGrid; // Sleeping bodies, rebuilt when islands fall asleep or wake
+
 } // namespace partioning
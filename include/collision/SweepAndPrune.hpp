@@ -0,0 +1,64 @@
+// SweepAndPrune.hpp, created by Andrew Gossen.
+
+// -----
+// Incremental sweep-and-prune broadphase backend.
+
+// - Keeps the min and max endpoints of every body's AABB in one sorted array per axis ( x and y ), across steps.
+// - Each step the endpoint values are refreshed and both arrays are re-sorted by insertion sort. Bodies move
+//   little between steps, so the arrays are nearly sorted and this costs close to O(n) plus O(swaps).
+// - Every swap of a min past a max is an overlap event on that axis:
+//   - a min moving below another body's max starts an overlap, the pair is added if the boxes now overlap on both axes
+//   - a max moving below another body's min ends an overlap, the pair is removed
+//   The persistent pair set is the previous step's set, minus the removals, plus the additions.
+// - Touching endpoints sort min first, so touching boxes count as overlapping, like AABBintersection().
+// - New bodies are appended past the end of the arrays and sorted into place, which reports their pairs
+//   through the same events. Bodies that leave ( asleep or removed ) have their endpoints and pairs dropped.
+
+// Compared to the other backends:
+// - Only exactly overlapping pairs are returned, and no work is spent on empty space or on body sizes,
+//   which suits long, narrow scenes ( chutes, conveyor lines ) where a grid wastes cells and a tree is deep.
+// - Many bodies moving fast, or many bodies stacked along both axes, cause many swaps, there the grid is better.
+
+// Thread Safety:
+// - NOT thread-safe, used from the physics thread only.
+// -----
+
+#pragma once
+#include "collision/AABB.hpp"
+#include "collision/Broadphase.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace partioning {
+
+class SweepAndPrune : public Broadphase{
+
+    public:
+
+    PairList findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                       JobSystem& jobs, FrameArena& arena) override;
+
+    private:
+
+    struct Endpoint{
+        float value;
+        uint32_t id; // Body slot << 1, low bit set for a max endpoint
+
+        uint32_t slot() const { return id >> 1; }
+        bool isMax() const { return id & 1u; }
+    };
+
+    std::vector<Endpoint> m_endpoints[2]; // Per axis, sorted by value, mins before maxes at equal values
+    std::vector<AABB> m_boxes; // Bounds of each slot this step
+    std::vector<uint8_t> m_inserted; // Whether each slot has endpoints in the arrays
+    std::vector<uint32_t> m_seen; // Step stamp of the last step each slot was a proxy
+    std::vector<uint64_t> m_pairs; // Persistent overlapping pairs, slot pair keys, sorted
+    std::vector<uint64_t> m_nextPairs; // Next step's m_pairs, swapped in so both keep their capacity
+    uint32_t m_stamp{0};
+
+    // Insertion sorts one axis, appending the overlap events its swaps cause
+    void sortAxis(int axis, FrameVector<uint64_t>& added, FrameVector<uint64_t>& removed);
+
+};
+
+} // namespace partioning
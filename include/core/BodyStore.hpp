@@ -0,0 +1,151 @@
+// BodyStore.hpp, created by Andrew Gossen.
+
+// -----
+// Structure-of-arrays (SoA) storage for every body simulated by the World.
+
+// Layout:
+// - Each hot simulation field (position, velocity, rotation, inverse mass/inertia, ...) lives in its
+//   own contiguous array, so the integrate/broadphase/solve loops only pull in the cache lines they use.
+// - Cold and render-only data (colour, sides, density, ...) lives in a separate side table ( info ).
+// - Local-space geometry is shared through the ShapeLibrary ( shapes ), each body only stores a ShapeId.
+// - Cached world-space vertices for every body live in one pooled buffer ( transformedVertices ),
+//   body i owns the range [vertexOffset[i], vertexOffset[i] + vertexCount[i]). Adding a body appends to
+//   the pool, removing one leaves a hole that is reclaimed by an occasional compaction.
+// - Index i refers to the same body in every array, and the arrays only ever hold live bodies.
+
+// Handles:
+// - add() returns a generational BodyHandle ( slot + generation ), which stays valid until that body is removed.
+// - Slots are recycled through a free list, and the generation is bumped on removal so stale handles
+//   are rejected by isValid()/indexOf().
+// - Removal swaps the last body into the hole ( O(1), no shifting ), so dense indices are NOT stable,
+//   keep a BodyHandle when a body needs to be referenced across steps.
+
+// Ownership & Lifetime:
+// - The store owns all body data. RigidBody is only used as a description that is copied in by add().
+
+// Thread Safety:
+// - BodyStore is NOT thread-safe.
+// -----
+
+#pragma once
+#include "core/RigidBody.hpp"
+#include "core/Shape.hpp"
+#include "core/Vector2.hpp"
+#include "collision/AABB.hpp"
+#include <vector>
+#include <cstdint>
+
+// Stable reference to a body in a BodyStore
+struct BodyHandle{
+    uint32_t slot{0xFFFFFFFFu};
+    uint32_t generation{0};
+
+    bool operator ==(const BodyHandle& other) const { return slot == other.slot && generation == other.generation; }
+    bool operator !=(const BodyHandle& other) const { return !(*this == other); }
+};
+
+// Cold per-body data, only read when rendering or when rebuilding mass properties
+struct BodyInfo{
+    ShapeType shape{Polygon};
+    int sides{0};
+    float radius{0.0f};
+    Colour colour{255.0f,255.0f,255.0f};
+    float density{0.0f};
+    float mass{0.0f};
+    float inertia{0.0f};
+    float area{0.0f};
+};
+
+struct BodyStore{
+
+    // Hot integration / solver data
+    std::vector<Vec2> position;
+    std::vector<Vec2> linearVelocity;
+    std::vector<float> rotation; // Radians
+    std::vector<float> rotorCos; // cos/sin of rotation, refreshed once per step by integration ( or setRotation() )
+    std::vector<float> rotorSin; // so transforms never call trig per vertex
+    std::vector<float> angularVelocity;
+    std::vector<float> inverseMass;
+    std::vector<float> inverseInertia;
+
+    // Material data, read by the solver
+    std::vector<float> restitution;
+    std::vector<float> staticFriction;
+    std::vector<float> dynamicFriction;
+
+    std::vector<uint8_t> isStatic;
+    std::vector<uint8_t> update; // Whether the cached world-space vertices need to be recalculated
+    std::vector<AABB> bounds; // Cached world-space AABB, refreshed by the broadphase for moving bodies
+
+    // Sleep state, only meaningful for non-static bodies
+    std::vector<uint8_t> awake;
+    std::vector<float> sleepTime; // Seconds spent below the World's sleep velocity thresholds
+    std::vector<uint32_t> sleepNext; // Slot of the next body in this body's sleeping island ( a ring )
+
+    // Continuous collision, only meaningful for non-static bodies
+    std::vector<uint8_t> ccdHeld; // Consecutive steps whose approach into a touched static was removed
+
+    // Geometry
+    ShapeLibrary shapes; // Shared local-space geometry
+    std::vector<ShapeId> shape; // Shape used by each body
+    std::vector<uint32_t> vertexOffset; // Start of each body's range in transformedVertices
+    std::vector<uint32_t> vertexCount;
+    std::vector<Vec2> transformedVertices; // Pooled cached world-space vertices of every body
+
+    // Cold side table
+    std::vector<BodyInfo> info;
+
+    std::vector<uint32_t> slot; // Handle slot owning each dense index, stable for the lifetime of a body
+
+    int size() const { return static_cast<int>(position.size()); }
+    bool empty() const { return position.empty(); }
+
+    BodyHandle add(const RigidBody& body); // Copies body into the store, returning its handle
+    bool remove(BodyHandle handle); // Removes the body in O(1), returns false if the handle is stale
+    void removeAt(int i); // Removes the body at dense index i, moving the last body into its place
+    void reserve(size_t n);
+    void clear();
+    uint64_t checksum() const; // Hash of every body's simulated state, equal only if the states are bit-identical
+
+    void setRotation(int i, float radians); // Sets rotation, its rotor, and marks the cached vertices stale
+
+    const Shape& shapeOf(int i) const { return shapes.get(shape[i]); }
+    Vec2* verticesOf(int i) { return transformedVertices.data() + vertexOffset[i]; } // Cached world-space vertices of body i
+    const Vec2* verticesOf(int i) const { return transformedVertices.data() + vertexOffset[i]; }
+
+    bool isValid(BodyHandle handle) const { return indexOf(handle) >= 0; }
+    int indexOf(BodyHandle handle) const; // Dense index of the body, or -1 if the handle is stale
+    int indexOfSlot(uint32_t s) const { return static_cast<int>(m_slots[s].dense); } // Precondition: slot s holds a live body
+    uint32_t slotCount() const { return static_cast<uint32_t>(m_slots.size()); } // Every live body's slot is below this
+    BodyHandle handleOf(int i) const { return BodyHandle{ slot[i], m_slots[slot[i]].generation }; }
+
+    // Removes every body for which pred(index) is true.
+    // Walks backwards so the body swapped into a hole has already been tested.
+    template<typename Pred>
+    void removeIf(Pred pred){
+        for (int i = size() - 1; i >= 0; --i) {
+            if (pred(i)) removeAt(i);
+        }
+    }
+
+    private:
+
+    struct Slot{
+        uint32_t dense; // Dense index while alive, next free slot while on the free list
+        uint32_t generation;
+    };
+
+    static constexpr uint32_t kNoSlot = 0xFFFFFFFFu;
+
+    std::vector<Slot> m_slots;
+    uint32_t m_freeHead{kNoSlot};
+
+    uint32_t m_deadVertices{0}; // Vertices in the pool no longer owned by any body
+    std::vector<Vec2> m_compactScratch; // Reused by compactVertices(), so compaction does not allocate once warm
+
+    ShapeId resolveShape(const RigidBody& body);
+    void compactVertices();
+    void moveBody(int from, int to);
+    void popBack();
+
+};
@@ -2,19 +2,20 @@
 // RigidBody.h, created by Andrew Gossen.
 
 // ---
-// Defines a physics data object representing a single rigid body.
+// Defines a physics data object describing a single rigid body.
 
 // Ownership & Lifetime:
-// - All RigidBody instances are owned by the World class.
+// - A RigidBody is a description, World::addBody() copies it into the World's BodyStore, 
+//   which owns and simulates the body from then on.
 // - A RigidBody object does not own external resources.
 
 // Invariants for a RigidBody:
-// - vertices are defined in local space relative to the body's COM.
+// - The geometry is described by parameters ( sides/radius, or width/height for boxes ), or by an explicit
+//   vertices outline. addBody() resolves it to a shared Shape in the ShapeLibrary, so identical bodies
+//   share one set of local-space vertices.
+// - vertices, when set, are defined in local space relative to the body's COM, convex and CCW.
 // - position and rotation define the authoritative world transform (i.e. the world-space position/rotation )
-// - transformedVertices are cached world-space vertices (world-space vertices represent 
-//.  vertices in their actual location, rather than being relative to the COM )
-// - If update == true, this implies the body has moved, transformedVertices 
-//.  MUST be recached to reflect the body's new position and rotation.
+// - If inertia is left at 0, it is computed from mass and the resolved shape when the body is added.
 
 // Thread Safety:
 // - RigidBody is NOT thread-safe.
@@ -30,7 +31,7 @@
 #include "core/Vector2.hpp"
 #include <vector>
 
-enum ShapeType{ // Implement later for optimisation
+enum ShapeType{ // Selects the narrowphase path, circles collide analytically and everything else through SAT
     Circle,Rectangle,Polygon
 };
 struct Colour{
@@ -39,9 +40,11 @@ struct Colour{
 
 struct RigidBody{ 
 
-    ShapeType shape; // Used to discern circle or rectangle for more efficent collision detection later on
-    int sides; // Sides 
-    int radius; // Radius 
+    ShapeType shape{Polygon}; // Used to discern circle or rectangle for more efficent collision detection
+    int sides{0}; // Sides 
+    float radius{0.0f}; // Radius ( of the circle, or of the regular polygon's vertices )
+    float width{0.0f}; // Box width, only used when shape == Rectangle
+    float height{0.0f}; // Box height, only used when shape == Rectangle
     // Constructor 
     RigidBody()=default;
     RigidBody(int n, float radius,float mass);
@@ -72,25 +75,20 @@ struct RigidBody{
     float area{0.0f};
     bool isStatic{false};
    
-    std::vector<Vec2> vertices {}; // Vertices relative to the bodies COM
-    std::vector<Vec2> transformedVertices {}; // Cached transformed vertices 
-    bool update{false}; // Whether the transformed vertices need to be recalculated 
+    std::vector<Vec2> vertices {}; // Optional custom outline relative to the bodies COM, empty for regular polygons and boxes
 
     // Position and rotation incrementing and setting 
 
     void move(const Vec2& amount){ // Move RigidBooy by amount
         position += amount;
-        update = true;
     }
     
     void rotate(const float radians){ // Rotate rigid body by given radians 
         rotation += radians;
-        update = true;
     }
 
     void snapTo(const Vec2& pos){ // Set RigidBody's position to pos 
         position = pos;
-        update = true;
     }
 
     void setStatic(bool value) { // Change the static state, and recompute intertia accordingly
@@ -109,3 +107,4 @@ struct RigidBody{
 // Defined in RigidBody.cpp
 float calculateInertia(RigidBody& body);
 void setBoxVertices(RigidBody& body, float height, float width);
+void setCircle(RigidBody& body, float radius);
@@ -0,0 +1,102 @@
+// Shape.hpp, created by Andrew Gossen.
+
+// -----
+// Shared, immutable local-space geometry for bodies.
+
+// Bodies no longer own their vertices, they refer to a Shape by ShapeId. Identical shapes
+// ( e.g. thousands of identical pegs ) are registered once and shared, so the trig to generate
+// vertices, the edge normals, area, inertia and bounding radius are all computed once per shape.
+
+// Ownership & Lifetime:
+// - ShapeLibrary owns every Shape, and shapes are never removed, so a ShapeId stays valid for the
+//   lifetime of the library.
+// - References returned by get() may be invalidated when a new shape is registered.
+
+// Conventions:
+// - vertices are CCW and relative to the shape's COM.
+// - normals[i] is the outward unit normal of the edge vertices[i] -> vertices[i+1].
+// - unitInertia is the moment of inertia about the COM for a mass of 1, so inertia = mass * unitInertia.
+// - Circles have no vertices or normals, only a radius. Collision handles them analytically, and any
+//   outline drawn for them is generated by the renderer.
+
+// Thread Safety:
+// - Registering shapes is NOT thread-safe, reading registered shapes is.
+// -----
+
+#pragma once
+#include "core/Vector2.hpp"
+#include "core/RigidBody.hpp"
+#include "collision/AABB.hpp"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using ShapeId = uint32_t;
+
+// Narrowphase class of a shape, picks the collision kernel for a pair of shapes ( see collide() ).
+// Boxes ( any quad with parallel opposite faces ) and polygons of up to kMaxFixedVertices vertices get kernels
+// specialised for their vertex count, larger polygons use the generic SAT path, and polygons of at least
+// kMinHullVertices vertices use GJK / EPA, whose cost grows with the log of the vertex count.
+enum class ShapeKind : uint8_t{
+    Circle,
+    Box,
+    Polygon3, Polygon4, Polygon5, Polygon6, Polygon7, Polygon8,
+    Polygon, // Any vertex count
+    Hull, // Many vertices
+    Count
+};
+
+constexpr int kMaxFixedVertices = 8;
+constexpr int kMinHullVertices = 32;
+
+struct Shape{
+    ShapeType type{Polygon};
+    ShapeKind kind{ShapeKind::Polygon};
+    std::vector<Vec2> vertices; // Local-space vertices, CCW
+    std::vector<Vec2> normals; // Outward unit edge normals
+    float radius{0.0f}; // Circles only
+    float area{0.0f};
+    float unitInertia{0.0f}; // Inertia per unit mass
+    float boundingRadius{0.0f}; // Largest distance from the COM to a vertex
+    float innerRadius{0.0f}; // Smallest distance from the COM to an edge ( the radius for circles )
+    AABB localBounds{}; // Bounds of the local-space vertices ( or the circle )
+};
+
+class ShapeLibrary{
+
+    public:
+
+    // Each returns the id of an existing identical shape when there is one, otherwise registers a new shape
+    ShapeId regularPolygon(int sides, float radius);
+    ShapeId box(float width, float height);
+    ShapeId circle(float radius);
+    ShapeId polygon(const std::vector<Vec2>& vertices); // vertices must be convex, CCW and relative to the COM
+
+    const Shape& get(ShapeId id) const { return m_shapes[id]; }
+    int size() const { return static_cast<int>(m_shapes.size()); }
+
+    private:
+
+    // Describes a shape by its parameters, so lookups never need to generate vertices
+    struct ShapeKey{
+        ShapeType type;
+        int sides;
+        float a; // Radius for regular polygons and circles, width for boxes
+        float b; // Height for boxes
+
+        bool operator ==(const ShapeKey& other) const {
+            return type == other.type && sides == other.sides && a == other.a && b == other.b;
+        }
+    };
+
+    struct ShapeKeyHash{
+        size_t operator()(const ShapeKey& key) const;
+    };
+
+    ShapeId add(ShapeType type, std::vector<Vec2> vertices);
+
+    std::vector<Shape> m_shapes;
+    std::unordered_map<ShapeKey, ShapeId, ShapeKeyHash> m_parametric; // Regular polygons and boxes
+    std::unordered_multimap<uint64_t, ShapeId> m_polygons; // Arbitrary polygons, keyed by a hash of their vertices
+
+};
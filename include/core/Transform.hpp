@@ -5,11 +5,25 @@
 // Holds utility type for 2D rigid transforms (rotation + translation).
 // Used to convert points from local space ( relative to Polygon's COM ) to world space.
 // All rotations are in radians.
+
+// Bodies store their rotation's cos/sin ( a rotor ), so transforming vertices is pure multiply-add.
+// transformPoints() is the batched kernel behind worldSpace(): AVX2 transforms 4 vertices per instruction,
+// SSE 2, with a scalar fallback for the remainder and for other targets ( AVX2 is enabled by the
+// PHYS_AVX2 CMake option ).
+// It runs once per body rather than over the whole transformedVertices pool: each body's vertices share one rotor
+// and translation, and are read from its Shape, not the pool, so a pool-wide pass would gather both per vertex.
 // ------
 
 #pragma once 
 #include "Vector2.hpp"
-#include "RigidBody.hpp"
+#include "BodyStore.hpp"
+#include <cmath>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 struct Transform{ 
 
@@ -30,42 +44,126 @@ struct Transform{
         rotation+=translation; 
     }
 
-    // Applies this transform to a local-space point, returning world-space.
-    Vec2 applyTransform(const Vec2& p) const { 
-        float c = std::cos(rotation);
-        float s = std::sin(rotation);
-        Vec2 rotated(
-            p.x * c - p.y * s,
-            p.x * s + p.y * c 
-        );
-        return rotated + position; // Return new transformed vector 
-    }
-
 };
 
 namespace physEng{
 
-    inline void worldSpace(RigidBody& body) { 
+    inline void transformPoints(const Vec2* local, Vec2* out, int count, float c, float s, const Vec2& translation) {
+
+        // --
+        // out[v] = R * local[v] + translation, with R the rotation given by its rotor (c, s)
+        // Vertices are kept interleaved (x, y, x, y, ...), so each register holds whole vertices and
+        // R * p is p * (c, c) + swap(p) * (-s, s). out and local must not overlap.
+        // --
+
+        if (count <= 0) return; // Nothing to address, local and out may be null
+
+        const float* in = &local[0].x;
+        float* dst = &out[0].x;
+        int v = 0;
+
+#if defined(__AVX2__)
+        const __m256 cos8 = _mm256_set1_ps(c);
+        const __m256 sin8 = _mm256_setr_ps(-s, s, -s, s, -s, s, -s, s);
+        const __m256 t8 = _mm256_setr_ps(translation.x, translation.y, translation.x, translation.y,
+                                         translation.x, translation.y, translation.x, translation.y);
+        for (; v + 4 <= count; v += 4) {
+            __m256 p = _mm256_loadu_ps(in + 2 * v);
+            __m256 swapped = _mm256_permute_ps(p, _MM_SHUFFLE(2, 3, 0, 1)); // (y, x) per vertex
+            __m256 r = _mm256_add_ps(_mm256_mul_ps(p, cos8), _mm256_mul_ps(swapped, sin8));
+            _mm256_storeu_ps(dst + 2 * v, _mm256_add_ps(r, t8));
+        }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+        const __m128 cos4 = _mm_set1_ps(c);
+        const __m128 sin4 = _mm_setr_ps(-s, s, -s, s);
+        const __m128 t4 = _mm_setr_ps(translation.x, translation.y, translation.x, translation.y);
+        for (; v + 2 <= count; v += 2) {
+            __m128 p = _mm_loadu_ps(in + 2 * v);
+            __m128 swapped = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 r = _mm_add_ps(_mm_mul_ps(p, cos4), _mm_mul_ps(swapped, sin4));
+            _mm_storeu_ps(dst + 2 * v, _mm_add_ps(r, t4));
+        }
+#endif
+        for (; v < count; ++v) { // Remainder / scalar fallback
+            const Vec2& p = local[v];
+            out[v] = Vec2(p.x * c - p.y * s + translation.x, p.x * s + p.y * c + translation.y);
+        }
+
+    }
+
+    inline void worldSpace(BodyStore& bodies, int i) { 
 
         // -- 
-        // This is used to update a RigidBody's vertices from local space ( relative to it's com ) to world space ( Using the x-y world co-ordinate system)
-        // param body - RigidBody to update vertices from local space to world space for, ( DOES NOT TAKE OWNERSHIP ) 
+        // This is used to update a body's vertices from local space ( relative to it's com ) to world space ( Using the x-y world co-ordinate system)
+        // param bodies - Body store holding the body ( DOES NOT TAKE OWNERSHIP ) 
+        // param i - Index of the body to update vertices from local space to world space for
+        // Uses the body's cached rotor, no trig is evaluated here.
         // -- 
 
-        if (!body.update && !body.transformedVertices.empty()) return;
+        if (!bodies.update[i]) return;
+
+        const Shape& shape = bodies.shapeOf(i);
+        const std::vector<Vec2>& local = shape.vertices; // Shared local-space vertices
+        if (shape.type == Circle || local.empty()) { // Nothing to transform, circles are bounded from their position
+            bodies.update[i] = 0;
+            return;
+        }
+        Vec2* transformed = bodies.verticesOf(i); // This body's range in the pooled vertex buffer
+
+        transformPoints(local.data(), transformed, static_cast<int>(local.size()),
+                        bodies.rotorCos[i], bodies.rotorSin[i], bodies.position[i]);
+
+        bodies.update[i] = 0; // Set cache update to false as the transformed vertices are up to date 
+        
+    }
 
-        Transform t(body.position, body.rotation);
+    inline AABB worldBounds(const BodyStore& bodies, int i) {
 
-        body.transformedVertices.clear();
-        body.transformedVertices.reserve(body.vertices.size());
+        // World-space AABB of body i. Polygons need their cached vertices up to date, circles only their position.
 
-        for (const Vec2& local : body.vertices) {
-            body.transformedVertices.push_back(t.applyTransform(local));
+        const Shape& shape = bodies.shapeOf(i);
+        if (shape.type == Circle) {
+            const Vec2 extent(shape.radius, shape.radius);
+            return AABB{ bodies.position[i] - extent, bodies.position[i] + extent };
         }
+        return getAABB(bodies.verticesOf(i), static_cast<int>(bodies.vertexCount[i]));
 
-        body.update = false; // Set cache update to false as the transformed vertices are up to date 
-        
     }
 
-}; // namespace physEng
+    inline AABB lazyBounds(const BodyStore& bodies, int i) {
+
+        // Conservative world-space AABB of body i from its transform alone, without its cached vertices.
+        // Both the bounding circle and the rotated local bounds contain the body, so their intersection does too.
+        // Never tighter than worldBounds(), and exact for circles and for axis-aligned rotations.
+
+        const Shape& shape = bodies.shapeOf(i);
+        const float c = bodies.rotorCos[i];
+        const float s = bodies.rotorSin[i];
+        const Vec2& p = bodies.position[i];
+
+        const Vec2 localCentre = (shape.localBounds.min + shape.localBounds.max) * 0.5f;
+        const Vec2 half = (shape.localBounds.max - shape.localBounds.min) * 0.5f;
+        const Vec2 centre(localCentre.x * c - localCentre.y * s + p.x, localCentre.x * s + localCentre.y * c + p.y);
+        const float ac = std::abs(c);
+        const float as = std::abs(s);
+        const Vec2 extent(ac * half.x + as * half.y, as * half.x + ac * half.y);
+
+        const float r = shape.boundingRadius;
+        return AABB{ Vec2(std::max(centre.x - extent.x, p.x - r), std::max(centre.y - extent.y, p.y - r)),
+                     Vec2(std::min(centre.x + extent.x, p.x + r), std::min(centre.y + extent.y, p.y + r)) };
+
+    }
+
+    inline Vec2 toLocal(const BodyStore& bodies, int i, const Vec2& worldPoint) {
+
+        // Inverse of body i's transform, expresses a world-space point in its local frame
+
+        const float c = bodies.rotorCos[i];
+        const float s = bodies.rotorSin[i];
+        Vec2 d = worldPoint - bodies.position[i];
+        return Vec2(d.x * c + d.y * s, -d.x * s + d.y * c);
 
+    }
+
+}; // namespace physEng
@@ -4,41 +4,201 @@
 // Owns and simulates all rigid bodies in the physics world.
 
 // Ownership & Lifetime:
-// - World owns all RigidBody instances stored in m_bodies.
-// - Bodies are stored by value for cache-friendly iteration.
-// - I havent safeguarded m_bodies, references/pointers to elements may be invalidated if m_bodies
-//   reallocates (e.g., when adding/removing bodies).
+// - World owns all bodies, stored in the structure-of-arrays BodyStore m_bodies.
+// - addBody() copies a RigidBody description into the store, the description can be discarded afterwards.
+// - Bodies are referenced from outside the World through the returned BodyHandle, which stays valid
+//   until the body is removed ( explicitly, or by culling once it falls below -m_yBounds ).
+// - Dense indices/pointers into the store's arrays may change whenever bodies are added or removed.
 
 // The actual physics simulation :
 // - step(dt) advances the simulation by dt seconds
 //  this dt value is integrated in the step function to advance the simulation.
 
+// Sleeping:
+// - Islands of touching dynamic bodies that stay below the sleep velocity thresholds for m_timeToSleep
+//   are put to sleep, and are then skipped by integration, vertex transformation, broadphase insertion and solving.
+// - A sleeping island wakes when an awake body touches it, or through wakeBody()/applyImpulse().
+// - Writing velocities/positions directly into the BodyStore does NOT wake a body, call wakeBody() first.
+
+// Broadphase:
+// - Candidate pairs come from a swappable backend ( see Broadphase.hpp ), by default a hierarchical grid whose
+//   cell size tunes itself to the bodies' sizes, its levels and cell occupancy are reported in WorldStats.
+// - BroadphaseType::Tree keeps a dynamic AABB tree between steps and only reinserts bodies that leave their
+//   fattened bounds, which suits large worlds of mostly slow bodies, or bodies of very different sizes.
+// - BroadphaseType::SweepAndPrune keeps sorted AABB endpoints between steps, which suits long, narrow scenes.
+// - Switching backend discards the old backend's state, the next step rebuilds it from scratch.
+
+// Lazy transforms:
+// - setLazyTransforms(true) bounds moving bodies from their position, rotation and shape bounds instead of their
+//   transformed vertices, and only transforms the vertices of bodies whose AABB intersects another's. In sparse
+//   scenes most bodies then skip vertex transformation entirely. Contacts are unchanged, the AABBs are only looser.
+// - Cached world-space vertices ( BodyStore::transformedVertices, verticesOf() ) may then be stale after step(),
+//   call updateVertices() before reading them ( e.g. to render ).
+
+// Continuous collision:
+// - Bodies moving more than half their inner radius in a step are swept against static geometry, and moved back to
+//   their time of impact if the sweep hits ( see continuousCollision() in world.cpp ). Thin statics then stop fast
+//   bodies even at large dt ( e.g. 1/30 s ), instead of being stepped over or pushed out of on the far side.
+// - Only fast bodies pay for it, and only against statics: fast dynamic pairs still rely on the discrete test.
+// - On by default, setContinuousCollision(false) restores purely discrete detection.
+
+// Static bodies:
+// - Statics are kept out of the per-step broadphase, in a grid baked once and rebuilt only when statics are added
+//   or removed. Awake bodies query it, so static geometry costs nothing per step beyond those queries.
+// - That grid, and the one of sleeping bodies, are hierarchical with the grid backend's tuned cell size, so large
+//   static geometry ( e.g. a floor ) sits in a few coarse cells. They are re-bucketed when the backend retunes.
+// - Moving a static body through the BodyStore requires setting its update flag and calling staticsChanged().
+
+// Solving:
+// - Contacts are solved with warm-started sequential impulses, see SolverSettings for the iteration modes, and for
+//   SolverMode::Substeps, which relaxes soft contacts over several substeps instead.
+// - Contacts are graph coloured into batches that share no dynamic body, each batch is solved across m_jobs.
+//   The result does not depend on the number of worker threads.
+
+// Determinism:
+// - For a given sequence of calls, step() produces the same result for any number of worker threads
+//   ( parallel outputs are merged, and reductions made, in a fixed chunk order ).
+// - setDeterministic(true) additionally sorts pairs and manifolds canonically by body slot, so contact order no
+//   longer depends on the broadphase backend, or on the insertion history of the tree and sweep-and-prune backends.
+//   It costs two sorts per step.
+// - checksum() hashes the simulated body state, matching checksums mean bit-identical states.
+
 // Thread Safety:
 // - World is NOT thread-safe.
+// - step() spreads its own work over m_jobs' worker threads, and returns once they are all idle again.
 // - All access must occur from the physics thread.
 // -------
 
 #pragma once
 #include "core/RigidBody.hpp"
+#include "core/BodyStore.hpp"
+#include "memory/FrameArena.hpp"
+#include "collision/Collision.hpp"
+#include "collision/Partitioning.hpp"
+#include "collision/PairCache.hpp"
+#include "collision/Broadphase.hpp"
+#include "jobs/JobSystem.hpp"
+#include <memory>
 #include <vector>
 #include "stats/world_stats.hpp"
 
+enum class SolverMode{
+    Iterations, // Sequential impulses over the whole step, then one positional correction pass
+    Substeps // Soft contacts relaxed once per substep, reusing the step's contacts
+};
+
+struct SolverSettings{
+
+    // Controls how the contact solver spends its work each step.
+
+    // SolverMode::Iterations ( default ) runs velocity iterations over the whole step:
+    // - Fixed mode runs exactly `iterations` sweeps over every contact.
+    // - Adaptive mode stops once a sweep changes no accumulated impulse by more than `tolerance` ( N*s ),
+    //   but always runs at least minIterations and at most maxIterations sweeps.
+
+    // SolverMode::Substeps splits the step into `substeps` substeps, each of which integrates velocities, solves every
+    // contact once with a soft constraint, integrates positions, then relaxes every contact once without bias:
+    // - Contacts are detected once per step, at the predicted end pose, and their separation is tracked from the
+    //   bodies' motion through the substeps. Pairs apart by up to speculativeDistance are given speculative contacts,
+    //   which bodies close exactly onto, so resting contacts that a push-out briefly opened are not lost for a step.
+    // - Penetration is pushed out by a damped spring of contactHertz / dampingRatio ( stiffness is capped at a quarter
+    //   of the substep rate ), no faster than maxPushVelocity, so there is no separate positional correction pass.
+    // - Many small substeps converge tall stacks better than many iterations of one large step, for less work.
+
+    SolverMode mode{SolverMode::Iterations};
+
+    bool adaptive{true};
+    int iterations{20}; // Fixed mode only
+    int minIterations{2};
+    int maxIterations{20};
+    float tolerance{1e-4f}; // Looser lets warm-started stacks stop after minIterations while they still sink
+
+    int substeps{4}; // Substeps mode only
+    float contactHertz{60.0f};
+    float dampingRatio{10.0f};
+    float maxPushVelocity{3.0f}; // m/s
+    float speculativeDistance{0.02f}; // m
+
+};
+
+enum class BroadphaseType{
+    Grid, // Hierarchical grid with an auto-tuned cell size, rebuilt every step
+    Tree, // Incremental dynamic AABB tree
+    SweepAndPrune // Incremental sorted endpoints on x and y
+};
+
 class World{ 
 
     public:
 
     Vec2 getGravity() const{ return gravity; } 
-    std::vector<RigidBody>& getBodies() { return m_bodies; } // Return rigid bodies in the world 
+    BodyStore& getBodies() { return m_bodies; } // Return the bodies in the world 
+    BodyHandle addBody(const RigidBody& body) { // Copies body into the world, returning its handle
+        if (body.isStatic) m_staticGridDirty = true;
+        return m_bodies.add(body);
+    }
+    bool removeBody(BodyHandle handle); // Returns false if the handle was already stale
+    bool isValid(BodyHandle handle) const { return m_bodies.isValid(handle); } 
+    void staticsChanged() { m_staticGridDirty = true; } // Call after moving static bodies through the BodyStore
+
+    bool wakeBody(BodyHandle handle); // Wakes the body's island, returns false if the handle is stale
+    bool applyImpulse(BodyHandle handle, const Vec2& impulse, const Vec2& worldPoint); // Wakes the body, then applies the impulse at worldPoint
+    void setSleepingEnabled(bool enabled); // Disabling sleep wakes every body
+    void setSolverSettings(const SolverSettings& settings) { m_solver = settings; }
+    const SolverSettings& getSolverSettings() const { return m_solver; }
+    void setWorkerThreads(int workers) { m_jobs = std::make_unique<JobSystem>(workers); } // 0 runs every stage on the calling thread
+    int getWorkerThreads() const { return m_jobs->workerCount(); }
+    void setDeterministic(bool enabled) { m_deterministic = enabled; }
+    bool isDeterministic() const { return m_deterministic; }
+    void setBroadphase(BroadphaseType type);
+    void setLazyTransforms(bool enabled) { m_lazyTransforms = enabled; }
+    bool isLazyTransforms() const { return m_lazyTransforms; }
+    void setContinuousCollision(bool enabled) { m_continuousCollision = enabled; }
+    bool isContinuousCollision() const { return m_continuousCollision; }
+    void updateVertices(); // Brings every body's cached world-space vertices up to date
+    BroadphaseType getBroadphase() const { return m_broadphaseType; }
+    uint64_t checksum() const { return m_bodies.checksum(); } // Compare between runs to verify they are bit-identical
     void step(float dt); // Step function for the world, called after each frame is rendered 
     WorldStats& getStats() { return m_stats; } 
 
     private:
 
-    std::vector<RigidBody> m_bodies; // All rigid bodies, static and non-static, in the world ( Of which the world takes ownership)
-    int solverIterations{20}; // Number of times collisions are solved per step 
+    BodyStore m_bodies; // All bodies, static and non-static, in the world ( Of which the world takes ownership)
+    SolverSettings m_solver; // Iteration count / convergence tolerance of the contact solver
     Vec2 gravity{0.0f,-9.81f}; 
     float m_yBounds=100.0f;
     WorldStats m_stats;
+    FrameArena m_frameArena; // Per-step scratch memory, reset at the start of every step
+    std::unique_ptr<JobSystem> m_jobs{std::make_unique<JobSystem>()}; // Worker threads used inside step()
+    std::vector<FrameArena> m_workerArenas; // Scratch memory of each worker thread ( JobSystem thread t uses [t - 1] )
+    bool m_deterministic{false}; // Canonical pair / manifold order, see Determinism above
+    partioning::GridConfig m_gridConfig;
+    BroadphaseType m_broadphaseType{BroadphaseType::Grid};
+    bool m_lazyTransforms{false}; // See Lazy transforms above
+    bool m_continuousCollision{true}; // See Continuous collision above
+    std::unique_ptr<partioning::Broadphase> m_broadphase{std::make_unique<partioning::GridBroadphase>(m_gridConfig)};
+    PairCache<CachedManifold> m_contactCache; // Last step's accumulated contact impulses, keyed by slot pair
+    PairCache<SeparatingAxis> m_axisCache; // Last step's separating axes of polygon pairs found apart, keyed by slot pair
+    std::vector<uint32_t> m_freedSlots; // Slots of bodies removed since the pair caches were last purged
+
+    // Sleeping
+    bool m_allowSleeping{true};
+    float m_sleepLinearVelocity{0.05f}; // Units per second
+    float m_sleepAngularVelocity{0.05f}; // Radians per second
+    float m_timeToSleep{0.5f}; // Seconds an island must stay below both thresholds before sleeping
+    partioning::RestingGrid m_sleepingGrid; // Bounds of sleeping bodies, queried by awake bodies
+    bool m_sleepingGridDirty{false};
+
+    // Static geometry
+    partioning::StaticGrid m_staticGrid; // Bounds of static bodies, baked once and queried by awake bodies
+    bool m_staticGridDirty{false};
+
+    void updateSleep(float dt, const FrameVector<Manifold>& manifolds);
+    void wakeIsland(int i);
+    void rebuildSleepingGrid();
+    void rebuildStaticGrid();
+    float persistentCellSize() const;
+    void evictFreedSlots();
 
 };
 
@@ -0,0 +1,107 @@
+// JobSystem.hpp, created by Andrew Gossen.
+
+// -----
+// Work-stealing pool of worker threads used to split data-parallel loops of a step across cores.
+
+// Usage:
+// - parallelFor(count, grain, fn) calls fn(begin, end) over [0, count) in chunks of at most grain items,
+//   and returns once every chunk has run. The calling thread works on chunks too.
+// - Loops with a single chunk ( count <= grain ), or a pool without workers, run inline on the caller.
+// - fn must only write data owned by its own [begin, end) range, or data owned by the running thread
+//   ( see currentThread() ).
+
+// Scheduling:
+// - Every thread starts with an equal, contiguous share of the chunks in its own queue and takes them from
+//   the front. A thread whose queue runs dry steals single chunks from the back of the others' queues, so
+//   uneven chunks ( e.g. crowded grid cells ) are balanced without a shared queue everyone contends on.
+
+// Ownership & Lifetime:
+// - Workers are started in the constructor and joined in the destructor.
+// - fn is borrowed for the duration of the call, parallelFor never allocates.
+
+// Thread Safety:
+// - parallelFor must only be called from one thread at a time ( the physics thread ), and not from inside fn.
+// -----
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+class JobSystem{
+
+    public:
+
+    explicit JobSystem(int workers = defaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int workerCount() const { return static_cast<int>(m_workers.size()); }
+    int threadCount() const { return workerCount() + 1; } // Workers plus the calling thread
+
+    template<typename Fn>
+    void parallelFor(int count, int grain, Fn&& fn){
+
+        if (count <= 0) return;
+        if (grain < 1) grain = 1;
+
+        if (m_workers.empty() || count <= grain) {
+            fn(0, count);
+            return;
+        }
+
+        // Type-erased through a plain function pointer, so no std::function ( and no allocation ) is needed
+        auto call = [](void* context, int begin, int end) { (*static_cast<Fn*>(context))(begin, end); };
+        dispatch(&fn, call, count, grain);
+
+    }
+
+    // Index of the calling thread within the pool running it: 0 for the thread calling parallelFor, 1..workerCount()
+    // for workers. Used inside fn to pick per-thread scratch memory and outputs.
+    static int currentThread();
+
+    static int defaultWorkerCount(); // One less than the hardware threads, the caller is the last one
+
+    private:
+
+    using ChunkFn = void(*)(void*, int, int);
+
+    // Chunks [front, back) still queued for one thread, packed into one word so the owner ( popping the front )
+    // and thieves ( popping the back ) agree through a single compare-exchange
+    struct alignas(64) ChunkQueue{
+        std::atomic<uint64_t> range{0};
+    };
+
+    struct Batch{
+        void* context{nullptr};
+        ChunkFn call{nullptr};
+        int count{0};
+        int grain{1};
+        int chunks{0};
+        std::atomic<int> doneChunks{0};
+    };
+
+    void dispatch(void* context, ChunkFn call, int count, int grain);
+    void runChunks(int thread);
+    bool popChunk(int queue, bool fromBack, int& chunk);
+    void runChunk(int chunk);
+    void workerLoop(int thread);
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<ChunkQueue[]> m_queues; // One per thread, index 0 is the calling thread
+    Batch m_batch; // The loop currently being run, only rewritten once no worker is inside it
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake; // Signals workers that a new batch ( or shutdown ) is available
+    std::condition_variable m_idle; // Signals the caller that the last worker has left the batch
+    uint64_t m_generation{0}; // Bumped for every batch, so a worker runs each batch at most once
+    int m_busyWorkers{0};
+    bool m_stop{false};
+
+};
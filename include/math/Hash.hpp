@@ -0,0 +1,23 @@
+// Hash.hpp, created by Andrew Gossen.
+// FNV-1a hashing of raw bytes, used to key shared shapes and to checksum simulation state.
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace hashing{
+
+    constexpr uint64_t kFnvSeed = 14695981039346656037ull;
+
+    inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size){
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+
+    }
+
+} // namespace hashing
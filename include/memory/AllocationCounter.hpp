@@ -0,0 +1,21 @@
+// AllocationCounter.hpp, created by Andrew Gossen.
+
+// -----
+// Debug counter of global heap allocations, used to prove World::step is allocation-free once warm.
+
+// Only active when built with -DPHYS_COUNT_ALLOCATIONS=ON, which links AllocationCounter.cpp and its
+// replacement operator new/delete. Otherwise heapAllocationCount() is always 0 and costs nothing.
+// -----
+
+#pragma once
+#include <cstdint>
+
+namespace memory{
+
+#ifdef PHYS_COUNT_ALLOCATIONS
+    uint64_t heapAllocationCount(); // Total calls to operator new since program start
+#else
+    inline uint64_t heapAllocationCount() { return 0; }
+#endif
+
+} // namespace memory
@@ -0,0 +1,135 @@
+// FrameArena.hpp, created by Andrew Gossen.
+
+// -----
+// Bump allocator for transient, per-step scratch memory ( AABBs, grid buckets, pair lists, manifolds, ... ).
+
+// Usage:
+// - World resets the arena once at the start of each step, everything allocated from it during the
+//   step is released at once. Individual deallocations are no-ops.
+// - ArenaAllocator<T> lets standard containers live in the arena, FrameVector<T> is the common case.
+
+// Growth:
+// - Allocations are bumped out of one block. If a step outgrows it, bigger overflow blocks are
+//   taken from the heap, and the next reset() replaces everything with a single block large enough
+//   for the peak. After the first few steps the arena therefore stops touching the heap entirely.
+
+// Ownership & Lifetime:
+// - Containers using the arena must be destroyed ( or never touched again ) before reset() is called.
+
+// Thread Safety:
+// - FrameArena is NOT thread-safe, each thread needs its own arena.
+// -----
+
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+class FrameArena{
+
+    public:
+
+    explicit FrameArena(size_t initialBytes = 1 << 20) { grow(initialBytes); }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    FrameArena(FrameArena&&) noexcept = default;
+    FrameArena& operator=(FrameArena&&) noexcept = default;
+
+    void* allocate(size_t bytes, size_t alignment){
+
+        // Bumps the offset within the current block, moving to a new overflow block if it is full.
+        // Alignment is relative to the block start, new[] blocks are aligned for any fundamental type.
+
+        size_t aligned = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (aligned + bytes > m_capacity) {
+            startOverflowBlock(bytes + alignment);
+            aligned = 0;
+        }
+
+        m_offset = aligned + bytes;
+        size_t used = m_retiredBytes + m_offset;
+        if (used > m_peak) m_peak = used;
+        return m_block.get() + aligned;
+
+    }
+
+    void reset(){
+
+        // Releases everything allocated since the last reset.
+        // If the step needed overflow blocks, they are merged into one bigger block sized for the peak.
+
+        if (!m_overflow.empty()) {
+            m_overflow.clear();
+            m_overflow.shrink_to_fit();
+            grow(m_peak + m_peak / 2);
+        }
+        m_offset = 0;
+        m_retiredBytes = 0;
+        m_peak = 0;
+
+    }
+
+    size_t capacity() const { return m_capacity; }
+    size_t peakBytes() const { return m_peak; } // Bytes used since the last reset
+    uint64_t heapAllocations() const { return m_heapAllocations; } // Blocks the arena has taken from the heap
+
+    private:
+
+    void grow(size_t bytes){
+        m_block.reset(new unsigned char[bytes]);
+        m_capacity = bytes;
+        m_heapAllocations++;
+    }
+
+    void startOverflowBlock(size_t minBytes){
+
+        // Keeps the full block alive until reset(), and continues in a block at least twice as big
+
+        m_retiredBytes += m_offset;
+        m_overflow.push_back(std::move(m_block));
+        grow(std::max(minBytes, m_capacity * 2));
+        m_offset = 0;
+
+    }
+
+    std::unique_ptr<unsigned char[]> m_block; // Current block being bumped
+    size_t m_capacity{0};
+    size_t m_offset{0};
+
+    std::vector<std::unique_ptr<unsigned char[]>> m_overflow; // Full blocks still in use this step
+    size_t m_retiredBytes{0}; // Bytes used in the overflow blocks
+
+    size_t m_peak{0};
+    uint64_t m_heapAllocations{0};
+
+};
+
+// Standard allocator adaptor, deallocate() is a no-op as the arena frees everything on reset()
+template<typename T>
+struct ArenaAllocator{
+
+    using value_type = T;
+
+    FrameArena* arena;
+
+    explicit ArenaAllocator(FrameArena& a) noexcept : arena(&a) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t n){
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) noexcept {}
+
+    template<typename U>
+    bool operator ==(const ArenaAllocator<U>& other) const noexcept { return arena == other.arena; }
+    template<typename U>
+    bool operator !=(const ArenaAllocator<U>& other) const noexcept { return arena != other.arena; }
+
+};
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -9,10 +9,41 @@ struct WorldStats {
     uint64_t broadChecks  = 0;
     uint64_t narrowChecks = 0;
     uint64_t contactsResolved = 0;
+    uint64_t contactsWarmStarted = 0; // Contact points that inherited impulses from the previous step
+    uint64_t axisCacheHits   = 0; // Polygon pairs that exited on last step's separating axis
+    uint64_t axisCacheMisses = 0; // Polygon pairs whose cached separating axis no longer separated them
+
+    // Grid broadphase, describing the most recent step ( zero with other backends )
+    uint64_t gridLevels = 0; // Hierarchical grid levels in use
+    float gridCellSize  = 0.0f; // Auto-tuned level 0 cell size, each level doubles it
+    uint64_t gridOccupancy[8] = {}; // Occupied cells by bodies held, bucket k counts [2^k, 2^(k+1)), the last is open-ended
+
+    // Continuous collision
+    uint64_t ccdBodies = 0; // Fast bodies swept against static geometry
+    uint64_t ccdHits   = 0; // ... of which moved back to their time of impact, or whose approach into a touched static was removed
+
+    // Solver
+    uint64_t solverIterations      = 0; // Sweeps used by the most recent step ( substeps in SolverMode::Substeps )
+    uint64_t solverIterationsTotal = 0;
+
+    // Sleeping, describing the most recent step
+    uint64_t sleepingBodies = 0;
+    uint64_t islands        = 0; // Awake islands built this step
+
+    // Memory, describing the most recent step
+    uint64_t frameArenaBytes     = 0; // Peak frame arena usage
+    uint64_t stepHeapAllocations = 0; // Heap allocations inside step(), only counted with PHYS_COUNT_ALLOCATIONS
 
     void resetStats(){
         steps=0;
-        bodyUpdates=0; broadChecks=0; narrowChecks=0;contactsResolved=0;
+        bodyUpdates=0; broadChecks=0; narrowChecks=0;contactsResolved=0; contactsWarmStarted=0;
+        axisCacheHits=0; axisCacheMisses=0;
+        solverIterations=0; solverIterationsTotal=0;
+        frameArenaBytes=0; stepHeapAllocations=0;
+        sleepingBodies=0; islands=0;
+        ccdBodies=0; ccdHits=0;
+        gridLevels=0; gridCellSize=0.0f;
+        for (uint64_t& cells : gridOccupancy) cells = 0;
     }
 
 };
@@ -18,6 +18,7 @@
 
 #pragma once
 #include "core/RigidBody.hpp"
+#include "core/BodyStore.hpp"
 #include "core/World.hpp"
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -36,9 +37,9 @@ public:
 
     bool isValid() const { return m_ok; }
 
-    // Draws a single rigid body using internal VAO/VBO + shader
+    // Draws a single body from the store using internal VAO/VBO + shader
     // Does not modify physics state.
-    void drawRigidBody(const RigidBody& body);
+    void drawBody(const BodyStore& bodies, int i);
 
     // Runs the render loop
     // Blocks until the window closes
@@ -0,0 +1,34 @@
+// AllocationCounter.cpp, created by Andrew Gossen.
+// Replaces the global operator new/delete to count heap allocations. Only built with PHYS_COUNT_ALLOCATIONS.
+
+#include "memory/AllocationCounter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> g_allocations{0};
+}
+
+uint64_t memory::heapAllocationCount(){
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size){
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment){
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    std::size_t rounded = ((size ? size : 1) + align - 1) / align * align; // aligned_alloc needs a multiple of the alignment
+    if (void* p = std::aligned_alloc(align, rounded)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
@@ -0,0 +1,283 @@
+// BodyStore.cpp, created by Andrew Gossen.
+// Copies RigidBody descriptions into the SoA body store, keeps every array in lockstep and manages body handles.
+
+#include "core/BodyStore.hpp"
+#include "core/Transform.hpp"
+#include "math/Hash.hpp"
+#include <cmath>
+
+BodyHandle BodyStore::add(const RigidBody& body){
+
+    // Splits a RigidBody description into the hot arrays and the cold side table.
+    // Resolves the body's geometry to a shared shape, and computes mass properties from it.
+    // Returns a handle to the new body, reusing a free slot when one is available.
+
+    const uint32_t dense = static_cast<uint32_t>(size());
+
+    uint32_t slotIndex;
+    if (m_freeHead != kNoSlot) { // Pop a recycled slot from the free list
+        slotIndex = m_freeHead;
+        m_freeHead = m_slots[slotIndex].dense;
+        m_slots[slotIndex].dense = dense;
+    } else {
+        slotIndex = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back(Slot{ dense, 1 }); // Generation starts at 1 so a default BodyHandle is never valid
+    }
+
+    const ShapeId shapeId = resolveShape(body);
+    const Shape& resolved = shapes.get(shapeId);
+
+    const float inertia = (body.inertia > 0.0f) ? body.inertia : body.mass * resolved.unitInertia;
+    const bool dynamic = !body.isStatic;
+
+    position.push_back(body.position);
+    linearVelocity.push_back(body.linearVelocity);
+    rotation.push_back(body.rotation);
+    rotorCos.push_back(std::cos(body.rotation));
+    rotorSin.push_back(std::sin(body.rotation));
+    angularVelocity.push_back(body.angularVelocity);
+    inverseMass.push_back((dynamic && body.mass > 0.0f) ? 1.0f / body.mass : 0.0f);
+    inverseInertia.push_back((dynamic && inertia > 0.0f) ? 1.0f / inertia : 0.0f);
+
+    restitution.push_back(body.restitution);
+    staticFriction.push_back(body.staticFriction);
+    dynamicFriction.push_back(body.dynamicFriction);
+
+    isStatic.push_back(body.isStatic ? 1 : 0);
+    update.push_back(1);
+    bounds.push_back(AABB{ body.position, body.position });
+
+    awake.push_back(1);
+    sleepTime.push_back(0.0f);
+    ccdHeld.push_back(0);
+    sleepNext.push_back(slotIndex);
+
+    // Append this body's world-space range to the vertex pool
+    shape.push_back(shapeId);
+    vertexOffset.push_back(static_cast<uint32_t>(transformedVertices.size()));
+    vertexCount.push_back(static_cast<uint32_t>(resolved.vertices.size()));
+    transformedVertices.resize(transformedVertices.size() + resolved.vertices.size());
+
+    info.push_back(BodyInfo{
+        body.shape,
+        body.sides,
+        body.radius,
+        body.colour,
+        body.density,
+        body.mass,
+        inertia,
+        resolved.area
+    });
+
+    slot.push_back(slotIndex);
+
+    physEng::worldSpace(*this, static_cast<int>(dense)); // Valid world-space vertices straight away, e.g. for rendering
+    bounds[dense] = physEng::worldBounds(*this, static_cast<int>(dense));
+
+    return BodyHandle{ slotIndex, m_slots[slotIndex].generation };
+
+}
+
+int BodyStore::indexOf(BodyHandle handle) const{
+
+    // Resolves a handle to its current dense index, returns -1 for stale or default handles
+
+    if (handle.slot >= m_slots.size()) return -1;
+    const Slot& s = m_slots[handle.slot];
+    if (s.generation != handle.generation) return -1;
+    if (s.dense >= static_cast<uint32_t>(size()) || slot[s.dense] != handle.slot) return -1; // Slot is on the free list
+    return static_cast<int>(s.dense);
+
+}
+
+bool BodyStore::remove(BodyHandle handle){
+
+    int i = indexOf(handle);
+    if (i < 0) return false;
+    removeAt(i);
+    return true;
+
+}
+
+void BodyStore::removeAt(int i){
+
+    // Swap-and-pop removal, the last body is moved into index i so no other body shifts.
+    // The freed slot's generation is bumped to invalidate outstanding handles, then it joins the free list.
+
+    const uint32_t freed = slot[i];
+    const int last = size() - 1;
+
+    // Release the vertex range, trimming the pool directly when the range sits at its end
+    if (vertexOffset[i] + vertexCount[i] == transformedVertices.size()) {
+        transformedVertices.resize(vertexOffset[i]);
+    } else {
+        m_deadVertices += vertexCount[i];
+    }
+
+    if (i != last) {
+        moveBody(last, i);
+        m_slots[slot[i]].dense = static_cast<uint32_t>(i);
+    }
+    popBack();
+
+    m_slots[freed].generation++;
+    m_slots[freed].dense = m_freeHead;
+    m_freeHead = freed;
+
+    if (m_deadVertices > 256 && m_deadVertices * 2 > transformedVertices.size()) compactVertices();
+
+}
+
+ShapeId BodyStore::resolveShape(const RigidBody& body){
+
+    // Maps a RigidBody's geometry description to a shared shape
+
+    if (body.shape == Circle) return shapes.circle(body.radius);
+    if (!body.vertices.empty()) return shapes.polygon(body.vertices);
+    if (body.shape == Rectangle) return shapes.box(body.width, body.height);
+    return shapes.regularPolygon(body.sides, body.radius);
+
+}
+
+void BodyStore::compactVertices(){
+
+    // Rebuilds the vertex pool without holes, amortised over the removals that created them.
+    // Cached vertices are copied as they are, so no body needs re-transforming.
+
+    m_compactScratch.clear();
+    m_compactScratch.reserve(transformedVertices.size() - m_deadVertices);
+
+    for (int i = 0; i < size(); ++i) {
+        const Vec2* first = verticesOf(i);
+        uint32_t offset = static_cast<uint32_t>(m_compactScratch.size());
+        m_compactScratch.insert(m_compactScratch.end(), first, first + vertexCount[i]);
+        vertexOffset[i] = offset;
+    }
+
+    transformedVertices.swap(m_compactScratch);
+    m_deadVertices = 0;
+
+}
+
+void BodyStore::setRotation(int i, float radians){
+
+    rotation[i] = radians;
+    rotorCos[i] = std::cos(radians);
+    rotorSin[i] = std::sin(radians);
+    update[i] = 1;
+
+}
+
+void BodyStore::reserve(size_t n){
+
+    position.reserve(n);
+    linearVelocity.reserve(n);
+    rotation.reserve(n);
+    rotorCos.reserve(n);
+    rotorSin.reserve(n);
+    angularVelocity.reserve(n);
+    inverseMass.reserve(n);
+    inverseInertia.reserve(n);
+    restitution.reserve(n);
+    staticFriction.reserve(n);
+    dynamicFriction.reserve(n);
+    isStatic.reserve(n);
+    update.reserve(n);
+    bounds.reserve(n);
+    awake.reserve(n);
+    sleepTime.reserve(n);
+    ccdHeld.reserve(n);
+    sleepNext.reserve(n);
+    shape.reserve(n);
+    vertexOffset.reserve(n);
+    vertexCount.reserve(n);
+    info.reserve(n);
+    slot.reserve(n);
+
+}
+
+void BodyStore::clear(){
+
+    // Removes every body, invalidating all outstanding handles
+
+    while (!empty()) removeAt(size() - 1);
+    transformedVertices.clear();
+    m_deadVertices = 0;
+
+}
+
+void BodyStore::moveBody(int from, int to){
+
+    // Moves the body at index from into index to, in every array
+
+    position[to] = position[from];
+    linearVelocity[to] = linearVelocity[from];
+    rotation[to] = rotation[from];
+    rotorCos[to] = rotorCos[from];
+    rotorSin[to] = rotorSin[from];
+    angularVelocity[to] = angularVelocity[from];
+    inverseMass[to] = inverseMass[from];
+    inverseInertia[to] = inverseInertia[from];
+    restitution[to] = restitution[from];
+    staticFriction[to] = staticFriction[from];
+    dynamicFriction[to] = dynamicFriction[from];
+    isStatic[to] = isStatic[from];
+    update[to] = update[from];
+    bounds[to] = bounds[from];
+    awake[to] = awake[from];
+    sleepTime[to] = sleepTime[from];
+    ccdHeld[to] = ccdHeld[from];
+    sleepNext[to] = sleepNext[from];
+    shape[to] = shape[from];
+    vertexOffset[to] = vertexOffset[from]; // The vertex range itself stays where it is in the pool
+    vertexCount[to] = vertexCount[from];
+    info[to] = info[from];
+    slot[to] = slot[from];
+
+}
+
+void BodyStore::popBack(){
+
+    position.pop_back();
+    linearVelocity.pop_back();
+    rotation.pop_back();
+    rotorCos.pop_back();
+    rotorSin.pop_back();
+    angularVelocity.pop_back();
+    inverseMass.pop_back();
+    inverseInertia.pop_back();
+    restitution.pop_back();
+    staticFriction.pop_back();
+    dynamicFriction.pop_back();
+    isStatic.pop_back();
+    update.pop_back();
+    bounds.pop_back();
+    awake.pop_back();
+    sleepTime.pop_back();
+    ccdHeld.pop_back();
+    sleepNext.pop_back();
+    shape.pop_back();
+    vertexOffset.pop_back();
+    vertexCount.pop_back();
+    info.pop_back();
+    slot.pop_back();
+
+}
+
+uint64_t BodyStore::checksum() const{
+
+    // FNV-1a over the raw bits of the state step() evolves, in dense order ( slots included, so two stores
+    // only match if the same bodies sit at the same indices ). Cheap enough to compare every frame.
+
+    uint64_t hash = hashing::kFnvSeed;
+    const size_t n = position.size();
+
+    hash = hashing::fnv1a(hash, slot.data(), n * sizeof(uint32_t));
+    hash = hashing::fnv1a(hash, position.data(), n * sizeof(Vec2));
+    hash = hashing::fnv1a(hash, linearVelocity.data(), n * sizeof(Vec2));
+    hash = hashing::fnv1a(hash, rotation.data(), n * sizeof(float));
+    hash = hashing::fnv1a(hash, angularVelocity.data(), n * sizeof(float));
+    hash = hashing::fnv1a(hash, awake.data(), n * sizeof(uint8_t));
+    return hash;
+
+}
@@ -0,0 +1,308 @@
+// DynamicTree.cpp, created by Andrew Gossen.
+// Dynamic AABB tree insertion, removal and balancing, and the incremental tree broadphase.
+
+#include "collision/DynamicTree.hpp"
+#include "math/Math.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace partioning {
+
+namespace {
+
+const float kTreeMargin = 0.1f; // Fat boxes are grown by this on every side
+const float kTreePrediction = 2.0f; // Fat boxes are stretched by this many steps of the body's current motion
+
+AABB combine(const AABB& a, const AABB& b) {
+    return { Vec2(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y)),
+             Vec2(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y)) };
+}
+
+float perimeter(const AABB& b) {
+    return 2.0f * ((b.max.x - b.min.x) + (b.max.y - b.min.y));
+}
+
+bool contains(const AABB& outer, const AABB& inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y;
+}
+
+AABB fatten(const AABB& b, const Vec2& displacement) {
+    AABB fat{ Vec2(b.min.x - kTreeMargin, b.min.y - kTreeMargin), Vec2(b.max.x + kTreeMargin, b.max.y + kTreeMargin) };
+    if (displacement.x < 0.0f) fat.min.x += displacement.x; else fat.max.x += displacement.x;
+    if (displacement.y < 0.0f) fat.min.y += displacement.y; else fat.max.y += displacement.y;
+    return fat;
+}
+
+} // namespace
+
+// -- DynamicTree
+
+int DynamicTree::allocateNode() {
+
+    if (m_free == kNull) {
+        m_nodes.emplace_back();
+        return static_cast<int>(m_nodes.size()) - 1;
+    }
+
+    const int id = m_free;
+    m_free = m_nodes[id].parent;
+    m_nodes[id] = Node{};
+    return id;
+
+}
+
+void DynamicTree::freeNode(int id) {
+    m_nodes[id].parent = m_free;
+    m_nodes[id].height = -1;
+    m_free = id;
+}
+
+int DynamicTree::createProxy(const AABB& box, uint32_t user) {
+    const int leaf = allocateNode();
+    m_nodes[leaf].box = box;
+    m_nodes[leaf].user = user;
+    insertLeaf(leaf);
+    return leaf;
+}
+
+void DynamicTree::destroyProxy(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+}
+
+void DynamicTree::insertLeaf(int leaf) {
+
+    if (m_root == kNull) {
+        m_root = leaf;
+        m_nodes[leaf].parent = kNull;
+        return;
+    }
+
+    // -- Find the best sibling, descending while a child is cheaper than pairing with the node itself.
+    // The cost of a choice is the perimeter of the new parent, plus the growth it causes in every ancestor.
+
+    const AABB box = m_nodes[leaf].box;
+    int index = m_root;
+    while (!m_nodes[index].isLeaf()) {
+
+        const Node& node = m_nodes[index];
+        const float area = perimeter(node.box);
+        const float combinedArea = perimeter(combine(node.box, box));
+
+        const float cost = 2.0f * combinedArea; // Pair with this node
+        const float inheritance = 2.0f * (combinedArea - area); // Growth pushed onto the ancestors when descending
+
+        auto descendCost = [&](int child) {
+            const Node& c = m_nodes[child];
+            const float grown = perimeter(combine(c.box, box));
+            return (c.isLeaf() ? grown : grown - perimeter(c.box)) + inheritance;
+        };
+        const float cost1 = descendCost(node.child1);
+        const float cost2 = descendCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) break;
+        index = (cost1 < cost2) ? node.child1 : node.child2;
+
+    }
+
+    // -- Replace the sibling with a new parent of the sibling and the leaf
+
+    const int sibling = index;
+    const int oldParent = m_nodes[sibling].parent;
+    const int newParent = allocateNode(); // May reallocate m_nodes, so no references are held across it
+
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].box = combine(box, m_nodes[sibling].box);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent == kNull) {
+        m_root = newParent;
+    } else if (m_nodes[oldParent].child1 == sibling) {
+        m_nodes[oldParent].child1 = newParent;
+    } else {
+        m_nodes[oldParent].child2 = newParent;
+    }
+
+    refit(m_nodes[leaf].parent);
+
+}
+
+void DynamicTree::removeLeaf(int leaf) {
+
+    if (leaf == m_root) {
+        m_root = kNull;
+        return;
+    }
+
+    // The leaf's parent is removed as well, its other child takes the parent's place
+
+    const int parent = m_nodes[leaf].parent;
+    const int grandParent = m_nodes[parent].parent;
+    const int sibling = (m_nodes[parent].child1 == leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent == kNull) {
+        m_root = sibling;
+        m_nodes[sibling].parent = kNull;
+        freeNode(parent);
+        return;
+    }
+
+    if (m_nodes[grandParent].child1 == parent) m_nodes[grandParent].child1 = sibling;
+    else m_nodes[grandParent].child2 = sibling;
+    m_nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    refit(grandParent);
+
+}
+
+void DynamicTree::refit(int id) {
+
+    while (id != kNull) {
+        id = balance(id);
+        Node& node = m_nodes[id];
+        node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+        node.box = combine(m_nodes[node.child1].box, m_nodes[node.child2].box);
+        id = node.parent;
+    }
+
+}
+
+int DynamicTree::balance(int iA) {
+
+    // If one child of A is more than one level taller than the other, the taller child is rotated up to A's
+    // place, and A takes over the taller child's shorter grandchild. Returns the node now at A's place.
+
+    Node& A = m_nodes[iA];
+    if (A.isLeaf() || A.height < 2) return iA;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+    Node& B = m_nodes[iB];
+    Node& C = m_nodes[iC];
+    const int difference = C.height - B.height;
+
+    if (difference > 1 || difference < -1) {
+
+        const bool rotateC = difference > 1;
+        const int iUp = rotateC ? iC : iB; // Child rotated up
+        const int iStay = rotateC ? iB : iC; // Child A keeps
+        Node& up = m_nodes[iUp];
+        const int iF = up.child1;
+        const int iG = up.child2;
+        Node& F = m_nodes[iF];
+        Node& G = m_nodes[iG];
+
+        // up replaces A under A's parent
+        up.child1 = iA;
+        up.parent = A.parent;
+        A.parent = iUp;
+        if (up.parent == kNull) m_root = iUp;
+        else if (m_nodes[up.parent].child1 == iA) m_nodes[up.parent].child1 = iUp;
+        else m_nodes[up.parent].child2 = iUp;
+
+        // up keeps its taller grandchild, A takes the shorter one in place of up
+        const bool keepF = F.height > G.height;
+        const int iKeep = keepF ? iF : iG;
+        const int iGive = keepF ? iG : iF;
+        up.child2 = iKeep;
+        if (rotateC) A.child2 = iGive; else A.child1 = iGive;
+        m_nodes[iGive].parent = iA;
+
+        const Node& stay = m_nodes[iStay];
+        A.box = combine(stay.box, m_nodes[iGive].box);
+        A.height = 1 + std::max(stay.height, m_nodes[iGive].height);
+        up.box = combine(A.box, m_nodes[iKeep].box);
+        up.height = 1 + std::max(A.height, m_nodes[iKeep].height);
+
+        return iUp;
+
+    }
+
+    return iA;
+
+}
+
+// -- TreeBroadphase
+
+PairList TreeBroadphase::findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                                   JobSystem& jobs, FrameArena& arena) {
+
+    // - Reinsert proxies whose bounds left their fat box ( and insert new ones )
+    // - Remove the leaves of slots that are no longer proxies ( asleep or removed )
+    // - Query the tree with every reinserted leaf for its new pairs
+    // - Keep the previous pairs that did not involve a reinserted or removed slot, and merge in the new ones
+
+    (void)jobs;
+    ++m_stamp;
+    m_movedSlots.clear();
+
+    for (int i : proxies) {
+
+        const uint32_t s = bodies.slot[i];
+        if (s >= m_leafOfSlot.size()) {
+            m_leafOfSlot.resize(s + 1, DynamicTree::kNull);
+            m_seen.resize(s + 1, 0);
+            m_moved.resize(s + 1, 0);
+        }
+        m_seen[s] = m_stamp;
+
+        int& leaf = m_leafOfSlot[s];
+        if (leaf != DynamicTree::kNull && contains(m_tree.fatAABB(leaf), bodies.bounds[i])) continue;
+
+        if (leaf != DynamicTree::kNull) m_tree.destroyProxy(leaf);
+        leaf = m_tree.createProxy(fatten(bodies.bounds[i], bodies.linearVelocity[i] * (dt * kTreePrediction)), s);
+        m_moved[s] = m_stamp;
+        m_movedSlots.push_back(s);
+
+    }
+
+    for (uint32_t s = 0; s < m_leafOfSlot.size(); ++s) {
+        if (m_leafOfSlot[s] == DynamicTree::kNull || m_seen[s] == m_stamp) continue;
+        m_tree.destroyProxy(m_leafOfSlot[s]);
+        m_leafOfSlot[s] = DynamicTree::kNull;
+    }
+
+    // -- New pairs of the reinserted leaves. A pair of two reinserted leaves is found by both, only the lower slot keeps it.
+
+    FrameVector<uint64_t> found{ArenaAllocator<uint64_t>(arena)};
+    for (uint32_t s : m_movedSlots) {
+        const int leaf = m_leafOfSlot[s];
+        m_tree.query(m_tree.fatAABB(leaf), [&](int other) {
+            const uint32_t t = m_tree.userData(other);
+            if (t == s) return;
+            if (m_moved[t] == m_stamp && t < s) return;
+            found.push_back(pairKey(static_cast<int>(s), static_cast<int>(t)));
+        });
+    }
+    std::sort(found.begin(), found.end());
+
+    // -- Merge. Kept pairs have no reinserted slot and found pairs all have one, so the two lists are disjoint.
+
+    FrameVector<uint64_t> kept{ArenaAllocator<uint64_t>(arena)};
+    kept.reserve(m_pairs.size());
+    for (uint64_t key : m_pairs) {
+        const uint32_t a = static_cast<uint32_t>(key >> 32);
+        const uint32_t b = static_cast<uint32_t>(key);
+        if (m_leafOfSlot[a] == DynamicTree::kNull || m_leafOfSlot[b] == DynamicTree::kNull) continue; // Removed
+        if (m_moved[a] == m_stamp || m_moved[b] == m_stamp) continue; // Re-found by the queries if still overlapping
+        kept.push_back(key);
+    }
+    m_nextPairs.clear();
+    std::merge(kept.begin(), kept.end(), found.begin(), found.end(), std::back_inserter(m_nextPairs)); // Not inplace_merge, which allocates
+    m_pairs.swap(m_nextPairs);
+
+    PairList pairs{ArenaAllocator<std::pair<int,int>>(arena)};
+    pairs.reserve(m_pairs.size());
+    for (uint64_t key : m_pairs) {
+        pairs.push_back({ bodies.indexOfSlot(static_cast<uint32_t>(key >> 32)), bodies.indexOfSlot(static_cast<uint32_t>(key)) });
+    }
+    return pairs;
+
+}
+
+} // namespace partioning
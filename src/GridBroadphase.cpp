@@ -0,0 +1,82 @@
+// GridBroadphase.cpp, created by Andrew Gossen.
+// Hierarchical grid broadphase backend, and the tuning of its cell size.
+
+#include "collision/Broadphase.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace partioning {
+
+PairList GridBroadphase::findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                                   JobSystem& jobs, FrameArena& arena) {
+
+    // - Retune the base cell size from the median body extent
+    // - Level and cell span per body, in parallel
+    // - Bucket and pair serially, then adjust the scale from the cells' occupancy
+
+    (void)dt;
+    const int count = static_cast<int>(proxies.size());
+
+    FrameVector<AABB> aabbs(count, AABB{}, ArenaAllocator<AABB>(arena));
+    FrameVector<float> extents(count, 0.0f, ArenaAllocator<float>(arena));
+    jobs.parallelFor(count, kSpanGrain, [&](int begin, int end) {
+        for (int a = begin; a < end; ++a) {
+            const AABB& b = bodies.bounds[proxies[a]];
+            aabbs[a] = b;
+            extents[a] = std::max(b.max.x - b.min.x, b.max.y - b.min.y);
+        }
+    });
+
+    if (count > 0) {
+        auto median = extents.begin() + count / 2;
+        std::nth_element(extents.begin(), median, extents.end());
+        const float target = std::max(*median * m_cellScale, 1e-3f);
+        if (std::fabs(target - m_cellSize) > kRetuneThreshold * m_cellSize) m_cellSize = target;
+    }
+
+    FrameVector<int> levels(count, 0, ArenaAllocator<int>(arena));
+    FrameVector<CellSpan> spans(count, CellSpan{}, ArenaAllocator<CellSpan>(arena));
+    GridLevels grid{ m_cellSize, kMaxGridLevels };
+    jobs.parallelFor(count, kSpanGrain, [&](int begin, int end) {
+        for (int a = begin; a < end; ++a) {
+            levels[a] = gridLevel(aabbs[a], grid);
+            spans[a] = cellSpan(aabbs[a], grid, levels[a]);
+        }
+    });
+
+    int used = 0;
+    for (int level : levels) used = std::max(used, level + 1);
+    grid.count = used;
+    m_levels = used;
+
+    std::fill(std::begin(m_occupancy), std::end(m_occupancy), 0);
+    PairList pairs = buildPairsFromLevels(aabbs, levels, spans, grid, arena, m_occupancy);
+    for (auto& p : pairs) p = { proxies[p.first], proxies[p.second] }; // Proxy indices -> body indices
+
+    // -- Occupancy feedback, mean bodies per occupied cell
+
+    uint64_t cells = 0;
+    uint64_t records = 0;
+    for (uint64_t n : m_occupancy) cells += n;
+    for (const CellSpan& span : spans) records += uint64_t(span.x1 - span.x0 + 1) * uint64_t(span.y1 - span.y0 + 1);
+    if (cells > 0) {
+        const float mean = float(records) / float(cells);
+        if (mean > kCrowdedOccupancy) m_cellScale = std::max(kMinCellScale, m_cellScale * 0.8f);
+        else if (mean < kSparseOccupancy) m_cellScale = std::min(kMaxCellScale, m_cellScale * 1.25f);
+    }
+
+    return pairs;
+
+}
+
+void GridBroadphase::reportStats(WorldStats& stats) const {
+
+    static_assert(sizeof(stats.gridOccupancy) / sizeof(stats.gridOccupancy[0]) == kOccupancyBuckets, "Histogram sizes differ");
+
+    stats.gridLevels = static_cast<uint64_t>(m_levels);
+    stats.gridCellSize = m_cellSize;
+    std::copy(std::begin(m_occupancy), std::end(m_occupancy), std::begin(stats.gridOccupancy));
+
+}
+
+} // namespace partioning
@@ -0,0 +1,161 @@
+// JobSystem.cpp, created by Andrew Gossen.
+// Starts, feeds and joins the worker threads behind JobSystem::parallelFor, and balances chunks between them.
+
+#include "jobs/JobSystem.hpp"
+#include <algorithm>
+
+namespace {
+
+    thread_local int t_threadIndex = 0; // Threads outside any pool ( the physics thread ) count as 0
+
+    uint64_t packRange(uint32_t front, uint32_t back) { return (uint64_t(back) << 32) | front; }
+    uint32_t rangeFront(uint64_t range) { return static_cast<uint32_t>(range); }
+    uint32_t rangeBack(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+
+} // namespace
+
+int JobSystem::currentThread(){ return t_threadIndex; }
+
+int JobSystem::defaultWorkerCount(){
+
+    unsigned int hardware = std::thread::hardware_concurrency();
+    return (hardware > 1) ? static_cast<int>(hardware) - 1 : 0;
+
+}
+
+JobSystem::JobSystem(int workers){
+
+    workers = std::max(workers, 0);
+    m_queues.reset(new ChunkQueue[workers + 1]);
+
+    m_workers.reserve(workers);
+    for (int i = 0; i < workers; ++i) {
+        m_workers.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+
+}
+
+JobSystem::~JobSystem(){
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) worker.join();
+
+}
+
+void JobSystem::dispatch(void* context, ChunkFn call, int count, int grain){
+
+    // Deals the chunks out to every thread's queue, works on them alongside the workers, then waits until every
+    // chunk has finished and every worker has left the batch ( so the caller's fn and the batch can safely go away ).
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_busyWorkers == 0; });
+
+        m_batch.context = context;
+        m_batch.call = call;
+        m_batch.count = count;
+        m_batch.grain = grain;
+        m_batch.chunks = (count + grain - 1) / grain;
+        m_batch.doneChunks.store(0, std::memory_order_relaxed);
+
+        const int threads = threadCount();
+        for (int t = 0; t < threads; ++t) {
+            uint32_t front = static_cast<uint32_t>(static_cast<int64_t>(m_batch.chunks) * t / threads);
+            uint32_t back = static_cast<uint32_t>(static_cast<int64_t>(m_batch.chunks) * (t + 1) / threads);
+            m_queues[t].range.store(packRange(front, back), std::memory_order_relaxed);
+        }
+
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runChunks(0);
+
+    // Chunks still running on workers are short, so spinning beats sleeping here
+    while (m_batch.doneChunks.load(std::memory_order_acquire) < m_batch.chunks) {
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_busyWorkers == 0; });
+
+}
+
+bool JobSystem::popChunk(int queue, bool fromBack, int& chunk){
+
+    // Takes one chunk off the front ( owner ) or back ( thief ) of a queue, false once it is empty
+
+    std::atomic<uint64_t>& range = m_queues[queue].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+
+    while (true) {
+
+        uint32_t front = rangeFront(current);
+        uint32_t back = rangeBack(current);
+        if (front >= back) return false;
+
+        uint64_t next = fromBack ? packRange(front, back - 1) : packRange(front + 1, back);
+        if (range.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            chunk = static_cast<int>(fromBack ? back - 1 : front);
+            return true;
+        }
+
+    }
+
+}
+
+void JobSystem::runChunk(int chunk){
+
+    int begin = chunk * m_batch.grain;
+    int end = std::min(begin + m_batch.grain, m_batch.count);
+    m_batch.call(m_batch.context, begin, end);
+    m_batch.doneChunks.fetch_add(1, std::memory_order_release);
+
+}
+
+void JobSystem::runChunks(int thread){
+
+    // Drains this thread's own queue, then steals from the others until every queue is empty
+
+    const int threads = threadCount();
+    int chunk;
+
+    while (popChunk(thread, false, chunk)) runChunk(chunk);
+
+    for (int offset = 1; offset < threads; ++offset) {
+        int victim = (thread + offset) % threads;
+        while (popChunk(victim, true, chunk)) runChunk(chunk);
+    }
+
+}
+
+void JobSystem::workerLoop(int thread){
+
+    t_threadIndex = thread;
+    uint64_t seen = 0;
+
+    while (true) {
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop) return;
+            seen = m_generation;
+            m_busyWorkers++;
+        }
+
+        runChunks(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_idle.notify_one();
+
+    }
+
+}
@@ -0,0 +1,177 @@
+// Shape.cpp, created by Andrew Gossen.
+// Generates, deduplicates and precomputes the mass properties of shared shapes.
+
+#include "core/Shape.hpp"
+#include "math/Math.hpp"
+#include "math/Hash.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+    std::vector<Vec2> generateRegularPolygon(int n, float r){
+
+        // Generates local-space vertices for a regular n-gon of radius r (centered at origin).
+        // Returns vertices in CCW order (suitable for SAT / outward normals).
+        // Preconditions: n >= 3, r > 0.
+
+        std::vector<Vec2> verts;
+        if (n < 3) return verts;
+        verts.reserve(n);
+
+        // Angle between consecutive vertices
+        const float dTheta = 2.0f * M_PI / static_cast<float>(n);
+        // Rotate so one vertex points up
+        const float startAngle = -M_PI / 2.0f;
+
+        for (int i = 0; i < n; ++i){ // Iterate through each side, and generate a vertex
+            float theta = startAngle + i * dTheta;
+            float x = r * std::cos(theta);
+            float y = r * std::sin(theta);
+            verts.emplace_back(x, y); // Construct the Vector2 point of this vertex within the verts vector
+        }
+
+        return verts;
+
+    }
+
+} // namespace
+
+size_t ShapeLibrary::ShapeKeyHash::operator()(const ShapeKey& key) const{
+
+    uint64_t hash = hashing::kFnvSeed;
+    hash = hashing::fnv1a(hash, &key.type, sizeof(key.type));
+    hash = hashing::fnv1a(hash, &key.sides, sizeof(key.sides));
+    hash = hashing::fnv1a(hash, &key.a, sizeof(key.a));
+    hash = hashing::fnv1a(hash, &key.b, sizeof(key.b));
+    return static_cast<size_t>(hash);
+
+}
+
+ShapeId ShapeLibrary::regularPolygon(int sides, float radius){
+
+    ShapeKey key{ Polygon, sides, radius, 0.0f };
+    auto it = m_parametric.find(key);
+    if (it != m_parametric.end()) return it->second; // Already generated, no trig needed
+
+    ShapeId id = add(Polygon, generateRegularPolygon(sides, radius));
+    m_parametric.emplace(key, id);
+    return id;
+
+}
+
+ShapeId ShapeLibrary::box(float width, float height){
+
+    ShapeKey key{ Rectangle, 4, width, height };
+    auto it = m_parametric.find(key);
+    if (it != m_parametric.end()) return it->second;
+
+    float hw = width  * 0.5f;
+    float hh = height * 0.5f;
+
+    // Local-space vertices ccw
+    ShapeId id = add(Rectangle, { Vec2(-hw, -hh), Vec2(hw, -hh), Vec2(hw, hh), Vec2(-hw, hh) });
+    m_parametric.emplace(key, id);
+    return id;
+
+}
+
+ShapeId ShapeLibrary::circle(float radius){
+
+    ShapeKey key{ Circle, 0, radius, 0.0f };
+    auto it = m_parametric.find(key);
+    if (it != m_parametric.end()) return it->second;
+
+    Shape shape;
+    shape.type = Circle;
+    shape.kind = ShapeKind::Circle;
+    shape.radius = radius;
+    shape.area = vecMath::pi * radius * radius;
+    shape.unitInertia = 0.5f * radius * radius; // Solid disc, I = m * r^2 / 2
+    shape.boundingRadius = radius;
+    shape.innerRadius = radius;
+    shape.localBounds = AABB{ Vec2(-radius, -radius), Vec2(radius, radius) };
+
+    m_shapes.push_back(std::move(shape));
+    ShapeId id = static_cast<ShapeId>(m_shapes.size() - 1);
+    m_parametric.emplace(key, id);
+    return id;
+
+}
+
+ShapeId ShapeLibrary::polygon(const std::vector<Vec2>& vertices){
+
+    uint64_t hash = hashing::fnv1a(hashing::kFnvSeed, vertices.data(), vertices.size() * sizeof(Vec2));
+
+    auto range = m_polygons.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) { // Confirm the match, hashes may collide
+        const std::vector<Vec2>& existing = m_shapes[it->second].vertices;
+        if (existing.size() == vertices.size() &&
+            std::memcmp(existing.data(), vertices.data(), vertices.size() * sizeof(Vec2)) == 0) {
+            return it->second;
+        }
+    }
+
+    ShapeId id = add(Polygon, vertices);
+    m_polygons.emplace(hash, id);
+    return id;
+
+}
+
+ShapeId ShapeLibrary::add(ShapeType type, std::vector<Vec2> vertices){
+
+    // Registers a new shape, precomputing everything bodies would otherwise recompute per instance.
+    // Area and inertia use the polygon's signed triangle fan about the COM ( origin ).
+
+    Shape shape;
+    shape.type = type;
+    shape.vertices = std::move(vertices);
+
+    const std::vector<Vec2>& verts = shape.vertices;
+    const size_t n = verts.size();
+    shape.normals.reserve(n);
+
+    float area = 0.0f;
+    float secondMoment = 0.0f; // Polar second moment of area about the origin
+
+    for (size_t i = 0; i < n; ++i) {
+
+        const Vec2& p1 = verts[i];
+        const Vec2& p2 = verts[(i + 1) % n];
+
+        Vec2 edge = p2 - p1;
+        shape.normals.push_back(Vec2(edge.y, -edge.x).normalise()); // Outward for CCW winding
+
+        float cross = vecMath::cross(p1, p2);
+        area += cross * 0.5f;
+        secondMoment += cross * (vecMath::dot(p1, p1) + vecMath::dot(p1, p2) + vecMath::dot(p2, p2)) / 12.0f;
+
+        shape.boundingRadius = std::max(shape.boundingRadius, p1.length());
+
+    }
+
+    if (n > 0) shape.localBounds = getAABB(verts.data(), static_cast<int>(n));
+    if (n > 0) shape.innerRadius = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < n; ++i) shape.innerRadius = std::min(shape.innerRadius, vecMath::dot(shape.normals[i], verts[i]));
+    shape.area = std::abs(area);
+    shape.unitInertia = (shape.area > 0.0f) ? std::abs(secondMoment) / shape.area : 0.0f;
+
+    // Pick the narrowphase kernel class. A quad whose opposite faces are parallel only has 2 distinct SAT axes.
+    const std::vector<Vec2>& normals = shape.normals;
+    if (n == 4 && vecMath::dot(normals[0], normals[2]) < -0.9999f && vecMath::dot(normals[1], normals[3]) < -0.9999f) {
+        shape.kind = ShapeKind::Box;
+    } else if (n >= 3 && n <= static_cast<size_t>(kMaxFixedVertices)) {
+        shape.kind = static_cast<ShapeKind>(static_cast<int>(ShapeKind::Polygon3) + static_cast<int>(n) - 3);
+    } else if (n < static_cast<size_t>(kMinHullVertices)) {
+        shape.kind = ShapeKind::Polygon;
+    } else {
+        shape.kind = ShapeKind::Hull;
+    }
+
+    m_shapes.push_back(std::move(shape));
+    return static_cast<ShapeId>(m_shapes.size() - 1);
+
+}
@@ -0,0 +1,146 @@
+// SweepAndPrune.cpp, created by Andrew Gossen.
+// Incremental sweep-and-prune, persistent endpoint arrays kept sorted by insertion sort.
+
+#include "collision/SweepAndPrune.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace partioning {
+
+namespace {
+
+float minOn(const AABB& b, int axis) { return axis == 0 ? b.min.x : b.min.y; }
+float maxOn(const AABB& b, int axis) { return axis == 0 ? b.max.x : b.max.y; }
+
+} // namespace
+
+void SweepAndPrune::sortAxis(int axis, FrameVector<uint64_t>& added, FrameVector<uint64_t>& removed) {
+
+    // Insertion sort, each endpoint moves down past every endpoint greater than it.
+    // Endpoints only ever pass each other once, so each event reflects the final order of that pair of endpoints.
+
+    std::vector<Endpoint>& endpoints = m_endpoints[axis];
+    const int count = static_cast<int>(endpoints.size());
+
+    for (int i = 1; i < count; ++i) {
+
+        const Endpoint e = endpoints[i];
+        int j = i;
+
+        while (j > 0) {
+
+            const Endpoint& other = endpoints[j - 1];
+            const bool below = e.value < other.value || (e.value == other.value && !e.isMax() && other.isMax());
+            if (!below) break;
+
+            if (e.isMax() != other.isMax()) {
+                const uint32_t a = e.slot();
+                const uint32_t b = other.slot();
+                if (!e.isMax()) { // e's min passed b's max, they may overlap now
+                    if (AABBintersection(m_boxes[a], m_boxes[b])) {
+                        added.push_back(pairKey(static_cast<int>(a), static_cast<int>(b)));
+                    }
+                } else { // e's max passed b's min, they no longer overlap
+                    const uint64_t key = pairKey(static_cast<int>(a), static_cast<int>(b));
+                    if (std::binary_search(m_pairs.begin(), m_pairs.end(), key)) removed.push_back(key); // Most never overlapped
+                }
+            }
+
+            endpoints[j] = other;
+            --j;
+
+        }
+
+        endpoints[j] = e;
+
+    }
+
+}
+
+PairList SweepAndPrune::findPairs(const BodyStore& bodies, const FrameVector<int>& proxies, float dt,
+                                  JobSystem& jobs, FrameArena& arena) {
+
+    // - Refresh the boxes of every proxy, appending endpoints for new ones
+    // - Drop the endpoints and pairs of slots that are no longer proxies ( asleep or removed )
+    // - Refresh the endpoint values and re-sort both axes, collecting overlap events
+    // - Apply the events to the persistent pair set
+
+    (void)dt;
+    (void)jobs;
+    ++m_stamp;
+
+    for (int i : proxies) {
+
+        const uint32_t s = bodies.slot[i];
+        if (s >= m_boxes.size()) {
+            m_boxes.resize(s + 1, AABB{});
+            m_inserted.resize(s + 1, 0);
+            m_seen.resize(s + 1, 0);
+        }
+
+        m_boxes[s] = bodies.bounds[i];
+        m_seen[s] = m_stamp;
+
+        if (!m_inserted[s]) { // Past the end of every array, the sort brings it in and reports its overlaps
+            m_inserted[s] = 1;
+            for (int axis = 0; axis < 2; ++axis) {
+                m_endpoints[axis].push_back({ minOn(m_boxes[s], axis), s << 1 });
+                m_endpoints[axis].push_back({ maxOn(m_boxes[s], axis), (s << 1) | 1u });
+            }
+        }
+
+    }
+
+    bool dropped = false;
+    for (uint32_t s = 0; s < m_inserted.size(); ++s) {
+        if (m_inserted[s] && m_seen[s] != m_stamp) {
+            m_inserted[s] = 0;
+            dropped = true;
+        }
+    }
+
+    FrameVector<uint64_t> added{ArenaAllocator<uint64_t>(arena)};
+    FrameVector<uint64_t> removed{ArenaAllocator<uint64_t>(arena)};
+
+    for (int axis = 0; axis < 2; ++axis) {
+        std::vector<Endpoint>& endpoints = m_endpoints[axis];
+        if (dropped) { // Removing entries keeps the rest sorted
+            endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(), [&](const Endpoint& e) { return !m_inserted[e.slot()]; }), endpoints.end());
+        }
+        for (Endpoint& e : endpoints) {
+            const AABB& box = m_boxes[e.slot()];
+            e.value = e.isMax() ? maxOn(box, axis) : minOn(box, axis);
+        }
+        sortAxis(axis, added, removed);
+    }
+
+    // -- Apply the events. A pair can only be added if it did not overlap before, and only removed if it
+    // does not overlap now, so the additions are disjoint from both the old set and the removals.
+
+    std::sort(added.begin(), added.end());
+    added.erase(std::unique(added.begin(), added.end()), added.end()); // Reported once per axis it started overlapping on
+    std::sort(removed.begin(), removed.end());
+
+    FrameVector<uint64_t> kept{ArenaAllocator<uint64_t>(arena)};
+    kept.reserve(m_pairs.size());
+    for (uint64_t key : m_pairs) {
+        const uint32_t a = static_cast<uint32_t>(key >> 32);
+        const uint32_t b = static_cast<uint32_t>(key);
+        if (!m_inserted[a] || !m_inserted[b]) continue; // Dropped
+        if (std::binary_search(removed.begin(), removed.end(), key)) continue;
+        kept.push_back(key);
+    }
+    m_nextPairs.clear();
+    std::merge(kept.begin(), kept.end(), added.begin(), added.end(), std::back_inserter(m_nextPairs));
+    m_pairs.swap(m_nextPairs);
+
+    PairList pairs{ArenaAllocator<std::pair<int,int>>(arena)};
+    pairs.reserve(m_pairs.size());
+    for (uint64_t key : m_pairs) {
+        pairs.push_back({ bodies.indexOfSlot(static_cast<uint32_t>(key >> 32)), bodies.indexOfSlot(static_cast<uint32_t>(key)) });
+    }
+    return pairs;
+
+}
+
+} // namespace partioning
@@ -4,10 +4,31 @@
 #include "collision/Collision.hpp"
 #include "core/Vector2.hpp"
 #include "math/Math.hpp"
+#include "memory/FrameArena.hpp"
 #include <vector>
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <array>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// A polygon as seen by the SAT kernels: its cached world-space vertices, plus the shape's precomputed
+// local unit normals and the body's rotor to rotate them into world space ( so no axis needs a sqrt ).
+struct SATPolygon{
+    const Vec2* vertices;
+    const Vec2* normals;
+    int count;
+    float c;
+    float s;
+};
+
+SATPolygon satPolygon(const BodyStore& bodies, int i){
+    return { bodies.verticesOf(i), bodies.shapeOf(i).normals.data(), static_cast<int>(bodies.vertexCount[i]),
+             bodies.rotorCos[i], bodies.rotorSin[i] };
+}
 
 // -- Contact Point Detection
 
@@ -15,89 +36,120 @@ struct contactResult{
     Vec2 contact1;
     Vec2 contact2;
     int contactCount{0};
+    float depth1{0.0f}; // How far each contact lies behind the reference face
+    float depth2{0.0f};
 };
 
-struct contactCandidate{
-    Vec2 point;
-    float distSq;
-    contactCandidate(const Vec2& p, float d) : point(p), distSq(d) {}
-};
+const float kClipTolerance = 0.005f; // Incident points this far outside the reference face still count as touching
+
+int supportVertex(const SATPolygon& polygon, const Vec2& direction, int start = 0) {
+
+    // Returns the vertex furthest along a world-space direction, by hill climbing the vertex ring from start.
+    // A convex ring's projections rise to one peak and fall again, so any local maximum is the global one. Steps
+    // start at a quarter of the ring and halve whenever neither neighbour at that distance is higher, which takes
+    // O(log n) projections ( plus the walk from start, so a nearby start, e.g. the last support vertex, helps ).
+
+    const int count = polygon.count;
+    int best = start;
+    float bestProjection = vecMath::dot(polygon.vertices[best], direction);
+
+    for (int step = std::max(1, count / 4); ; ) {
+        const int forward = (best + step) % count;
+        const int backward = (best - step + count) % count;
+        const float forwardProjection = vecMath::dot(polygon.vertices[forward], direction);
+        const float backwardProjection = vecMath::dot(polygon.vertices[backward], direction);
+
+        if (forwardProjection > bestProjection && forwardProjection >= backwardProjection) {
+            best = forward;
+            bestProjection = forwardProjection;
+        } else if (backwardProjection > bestProjection) {
+            best = backward;
+            bestProjection = backwardProjection;
+        } else if (step == 1) {
+            return best;
+        } else {
+            step /= 2;
+        }
+    }
 
-contactResult getContactPoints(const RigidBody& A, const RigidBody& B) {
+}
 
-    // Computes up to two contact points between two colliding convex polygons
-    // using point-to-edge distance candidates.
-    // Preconditions: A/B transformedVertices are up-to-date and non-empty.
-    // Returns contactCount in [0, 2].
-    // Does not take ownership of A/B.
+int extremeFace(const SATPolygon& polygon, const Vec2& direction) {
 
-    if (A.transformedVertices.empty() || B.transformedVertices.empty()) { // Start off with a sanity check of precondition
-        return { Vec2(0,0), Vec2(0,0), 0 };
-    }
+    // Returns the face whose normal is most aligned with a world-space direction. It is one of the two faces
+    // meeting at the support vertex, so this is as cheap as supportVertex().
+    // The direction is rotated into the polygon's local space once, so the precomputed normals are used as-is.
 
-    std::vector<contactCandidate> candidates;
-    candidates.reserve(
-        A.transformedVertices.size() * B.transformedVertices.size() * 2
-    ); 
+    const int vertex = supportVertex(polygon, direction);
+    const int previous = (vertex == 0) ? polygon.count - 1 : vertex - 1;
 
-    // Helper function that pushes candidates for 'points of P to edges of Q'
-    auto gatherCandidates = [&](const RigidBody& P, const RigidBody& Q) {
+    const Vec2 local(direction.x * polygon.c + direction.y * polygon.s, direction.y * polygon.c - direction.x * polygon.s);
+    return (vecMath::dot(polygon.normals[previous], local) > vecMath::dot(polygon.normals[vertex], local)) ? previous : vertex;
 
-        const auto& vertsP = P.transformedVertices;
-        const auto& vertsQ = Q.transformedVertices;
+}
 
-        for (const Vec2& vP : vertsP) {
-            for (size_t i = 0; i < vertsQ.size(); ++i) {
-                const Vec2& q1 = vertsQ[i];
-                const Vec2& q2 = vertsQ[(i + 1) % vertsQ.size()];
-                Vec2 contact;
-                float d2 = vecMath::pointSegmentDistance(q1, q2, vP, contact);
-                candidates.emplace_back(contact, d2);
-            }
-        }
+contactResult clipContacts(const SATPolygon& reference, const SATPolygon& incident, const Vec2& normal, float margin) {
+
+    // Computes up to two contact points between two colliding convex polygons by clipping.
+    // normal is the SAT axis pointing out of the reference polygon, the one that owned the axis of least penetration.
+    // - The reference face is the reference polygon's face most aligned with normal.
+    // - The incident face is the incident polygon's face most opposed to it.
+    // - The incident face is clipped to the reference face's side planes, and the clipped points that are
+    //   behind the reference face ( within kClipTolerance, or margin when larger ) are the contacts.
+    // O(log n + log m) and allocation free. Preconditions: both polygons are up-to-date and non-empty.
+
+    const int referenceFace = extremeFace(reference, normal);
+    const int incidentFace = extremeFace(incident, normal * -1);
+
+    const Vec2& v1 = reference.vertices[referenceFace];
+    const Vec2& v2 = reference.vertices[(referenceFace + 1 == reference.count) ? 0 : referenceFace + 1];
+    Vec2 points[2] = { incident.vertices[incidentFace], incident.vertices[(incidentFace + 1 == incident.count) ? 0 : incidentFace + 1] };
+
+    // -- Clip the incident edge to the slab between the reference face's side planes
+
+    const Vec2 tangent = v2 - v1;
+    const float lower = vecMath::dot(tangent, v1);
+    const float upper = vecMath::dot(tangent, v2);
+
+    auto clip = [&](float offset, float sign) { // Keeps the part of the edge where sign * ( dot(tangent, p) - offset ) <= 0
+        const float d0 = sign * (vecMath::dot(tangent, points[0]) - offset);
+        const float d1 = sign * (vecMath::dot(tangent, points[1]) - offset);
+        if (d0 > 0.0f && d1 > 0.0f) return false; // Entirely outside, only possible through round-off
+        if (d0 > 0.0f) points[0] = points[0] + (points[1] - points[0]) * (d0 / (d0 - d1));
+        else if (d1 > 0.0f) points[1] = points[1] + (points[0] - points[1]) * (d1 / (d1 - d0));
+        return true;
     };
 
-    // Collect from both directions
-    gatherCandidates(A, B);
-    gatherCandidates(B, A);
+    contactResult result{ Vec2(0,0), Vec2(0,0), 0 };
+    const float face = vecMath::dot(normal, v1);
 
-    if (candidates.empty()) {
-        return { Vec2(0,0), Vec2(0,0), 0 };
+    if (!clip(lower, -1.0f) || !clip(upper, 1.0f)) { // Degenerate, fall back to the incident vertex deepest along normal
+        const Vec2& a = incident.vertices[incidentFace];
+        const Vec2& b = incident.vertices[(incidentFace + 1 == incident.count) ? 0 : incidentFace + 1];
+        result.contact1 = (vecMath::dot(a, normal) < vecMath::dot(b, normal)) ? a : b;
+        result.depth1 = face - vecMath::dot(normal, result.contact1);
+        result.contactCount = 1;
+        return result;
     }
 
-    // Find the global minimum distance 
-    float minDistSq = candidates[0].distSq;
-    for (const auto& c : candidates) {
-        if (c.distSq < minDistSq) {
-            minDistSq = c.distSq;
-        }
-    }
-    
-    const float eps = 0.0001f; // The tolerance value, determines the 'close enough' threshold
-    // Two vertices may be close but not exactly touching, if they're close enough we should still register it as a contact point
-    float threshold = minDistSq + eps; // This defines how close 'close enough' is 
-
-    Vec2 contact1{};
-    Vec2 contact2{};
-    int  contactCount = 0;
-
-    for (const auto& c : candidates) {
-        if (c.distSq <= threshold) { // Only one contact point 
-            contact1 = c.point;
-            contactCount = 1;
-            break;
-        }
+    // -- Keep the points behind the reference face
+
+    const float tolerance = std::max(kClipTolerance, margin);
+    for (const Vec2& point : points) {
+        if (vecMath::dot(normal, point) - face > tolerance) continue;
+        if (result.contactCount == 1 && vecMath::vecCloselyEqual(result.contact1, point)) continue;
+        (result.contactCount == 0 ? result.contact1 : result.contact2) = point;
+        (result.contactCount == 0 ? result.depth1 : result.depth2) = face - vecMath::dot(normal, point);
+        ++result.contactCount;
     }
 
-    for (const auto& c : candidates) {
-        if (c.distSq <= threshold && !vecMath::vecCloselyEqual(contact1, c.point)) { // Two contact points 
-            contact2 = c.point;
-            contactCount = 2;
-            break;
-        }
+    if (result.contactCount == 0) { // Both clipped points only just outside the tolerance, keep the deeper one
+        result.contact1 = (vecMath::dot(normal, points[0]) < vecMath::dot(normal, points[1])) ? points[0] : points[1];
+        result.depth1 = face - vecMath::dot(normal, result.contact1);
+        result.contactCount = 1;
     }
 
-    return { contact1, contact2, contactCount };
+    return result;
 
 }
 
@@ -105,7 +157,62 @@ contactResult getContactPoints(const RigidBody& A, const RigidBody& B) {
 
 // Helper functions for SATCollision
 
-void projectAxis(const std::vector<Vec2>& vertices,const Vec2& normalAxis,float& max,float& min){ 
+// Calls f(i) for i in [0, count) until it returns false, returning false if it did.
+// With N > 0 the count is N and the loop is fully unrolled at compile time, with N == 0 it is a runtime loop.
+template<typename F, size_t... I>
+inline bool forEachUnrolled(F&& f, std::index_sequence<I...>) {
+    return (f(static_cast<int>(I)) && ...);
+}
+
+template<int N, typename F>
+inline bool forEach(int count, F&& f) {
+    if constexpr (N > 0) {
+        (void)count;
+        return forEachUnrolled(f, std::make_index_sequence<N>{});
+    } else {
+        for (int i = 0; i < count; ++i) {
+            if (!f(i)) return false;
+        }
+        return true;
+    }
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+void projectAxis(const Vec2* vertices,int count,const Vec2& normalAxis,float& max,float& min){
+
+    // Projects polygon vertices onto a single axis, two vertices per iteration ( [x0 y0 x1 y1] times [ax ay ax ay],
+    // then each x product added to its y product ). An odd last vertex is projected twice.
+    // Preconditions: vertices is non-empty.
+
+    const __m128 axis = _mm_setr_ps(normalAxis.x, normalAxis.y, normalAxis.x, normalAxis.y);
+    __m128 lo = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 hi = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+
+    int i = 0;
+    for (; i + 1 < count; i += 2) {
+        __m128 products = _mm_mul_ps(_mm_loadu_ps(&vertices[i].x), axis);
+        __m128 projection = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1)));
+        lo = _mm_min_ps(lo, projection);
+        hi = _mm_max_ps(hi, projection);
+    }
+    if (i < count) {
+        __m128 products = _mm_mul_ps(_mm_setr_ps(vertices[i].x, vertices[i].y, vertices[i].x, vertices[i].y), axis);
+        __m128 projection = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1)));
+        lo = _mm_min_ps(lo, projection);
+        hi = _mm_max_ps(hi, projection);
+    }
+
+    lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo)); // Even and odd vertices' projections sit in lanes 0 / 2
+    hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+    min = _mm_cvtss_f32(lo);
+    max = _mm_cvtss_f32(hi);
+
+}
+
+#else
+
+void projectAxis(const Vec2* vertices,int count,const Vec2& normalAxis,float& max,float& min){ 
     
    // Projects polygon vertices onto an axis and outputs the [min, max] interval.
    // min and max are used to discern if two projections overlap or not, used to discern seperating axis. 
@@ -113,7 +220,7 @@ void projectAxis(const std::vector<Vec2>& vertices,const Vec2& normalAxis,float&
 
     float projection = vecMath::dot(vertices[0], normalAxis);
     min = max = projection; // Establish a baseline 
-    for (size_t i=1;i<vertices.size();++i){ // Starting from one as we already established vertices[0] 
+    for (int i=1;i<count;++i){ // Starting from one as we already established vertices[0] 
         const Vec2& vertice = vertices[i];
         float projection=vecMath::dot(vertice,normalAxis);
         if (projection<min){ min=projection; }
@@ -122,31 +229,116 @@ void projectAxis(const std::vector<Vec2>& vertices,const Vec2& normalAxis,float&
 
 }
 
+#endif
+
+bool separatesOn(const SATPolygon& owner,const SATPolygon& other,int face,float margin){
+
+    // Tests a single face normal of owner as a separating axis ( by a gap wider than margin ), used to retry
+    // last time's separating axis first
+
+    const Vec2& n = owner.normals[face];
+    const Vec2 axis(n.x * owner.c - n.y * owner.s, n.x * owner.s + n.y * owner.c);
+
+    float maxA,minA;
+    float maxB,minB;
+    projectAxis(owner.vertices,owner.count,axis,maxA,minA);
+    projectAxis(other.vertices,other.count,axis,maxB,minB);
+    return maxA + margin < minB || maxB + margin < minA;
+
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+void projectAxes4(const Vec2* vertices,int count,__m128 axisX,__m128 axisY,__m128& max,__m128& min){
+
+    // Projects every vertex onto 4 axes at once ( one axis per lane ), outputting each axis' [min, max] interval.
+    // Each vertex is broadcast and projected with one multiply-add per component, so the vertex data stays in
+    // the pooled interleaved layout. Preconditions: count > 0.
+
+    __m128 projection = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertices[0].x), axisX), _mm_mul_ps(_mm_set1_ps(vertices[0].y), axisY));
+    min = max = projection;
+    for (int i=1;i<count;++i){
+        projection = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertices[i].x), axisX), _mm_mul_ps(_mm_set1_ps(vertices[i].y), axisY));
+        min = _mm_min_ps(min, projection);
+        max = _mm_max_ps(max, projection);
+    }
+
+}
+
+bool SATLoop(const SATPolygon& a,const SATPolygon& b,float margin,float& penetration,Vec2& normal,int& separating){
+
+    // Runs the SAT loop over a's face normals, 4 axes per iteration, attempting to find a 'seperating axis'.
+    // A trailing group with fewer than 4 axes repeats its last axis in the unused lanes.
+    // On separation ( a gap wider than margin ), separating is set to the first separating face.
+    // Does not take ownership of either polygon's data.
+
+    const __m128 gap = _mm_set1_ps(margin);
+    alignas(16) float axisX[4];
+    alignas(16) float axisY[4];
+    alignas(16) float depth[4];
+
+    for (int first=0;first<a.count;first+=4){
+
+        const int lanes = std::min(4, a.count - first);
+        for (int l=0;l<4;++l){ // Rotate the shape's local normals into world space
+            const Vec2& n = a.normals[first + std::min(l, lanes - 1)];
+            axisX[l] = n.x * a.c - n.y * a.s;
+            axisY[l] = n.x * a.s + n.y * a.c;
+        }
+
+        const __m128 x = _mm_load_ps(axisX);
+        const __m128 y = _mm_load_ps(axisY);
+
+        __m128 maxA,minA;
+        __m128 maxB,minB;
+        projectAxes4(a.vertices,a.count,x,y,maxA,minA);
+        projectAxes4(b.vertices,b.count,x,y,maxB,minB);
+
+        __m128 separated = _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(maxA, gap), minB), _mm_cmplt_ps(_mm_add_ps(maxB, gap), minA));
+        if (const int mask = _mm_movemask_ps(separated)) { // A gap was found on at least one axis, so the polygons are seperated.
+            int lane = 0;
+            while (!(mask & (1 << lane))) ++lane;
+            separating = first + std::min(lane, lanes - 1);
+            return false;
+        }
+
+        // At this point, we know there is overlap on all 4 axes, keep the shallowest ( first one on ties, like the scalar loop )
+        _mm_store_ps(depth, _mm_min_ps(_mm_sub_ps(maxA, minB), _mm_sub_ps(maxB, minA)));
+        for (int l=0;l<lanes;++l){
+            if (depth[l] < penetration){
+                penetration = depth[l];
+                normal = Vec2(axisX[l], axisY[l]);
+            }
+        }
+
+    }
+
+    return true;
+
+}
+
+#else
 
-bool SATLoop(const RigidBody& A,const RigidBody& B,float& penetration,Vec2& normal){
+bool SATLoop(const SATPolygon& a,const SATPolygon& b,float margin,float& penetration,Vec2& normal,int& separating){
 
-    // Runs the SAT loop, checking the normal of each polygon face and then projecting to attempt to find a 'seperating axis'.
-    // Does not take ownership of A or B.
-  
-    const auto& verticesA = A.transformedVertices;
-    const auto& verticesB = B.transformedVertices;
+    // Scalar fallback, runs the SAT loop one face normal at a time, attempting to find a 'seperating axis'.
+    // On separation ( a gap wider than margin ), separating is set to the separating face.
+    // Does not take ownership of either polygon's data.
 
-    for (size_t i=0;i<verticesA.size();i++){   // Loops through a polygon's vertices to evaluate each normal axis
-       
-        const Vec2& va = verticesA[i]; 
-        const Vec2& vb = verticesA[(i+1) % verticesA.size()]; // Wrap around indexing 
-        Vec2 edge = vb - va;
-        Vec2 normalAxis = Vec2(-edge.y,edge.x); // The axis to test for seperation, in Clockwise winding order 
-        normalAxis = normalAxis.normalise();
+    for (int i=0;i<a.count;i++){   // Loops through a polygon's faces to evaluate each normal axis
+
+        const Vec2& n = a.normals[i];
+        Vec2 normalAxis(n.x * a.c - n.y * a.s, n.x * a.s + n.y * a.c); // Precomputed unit normal, rotated into world space
 
         float maxA,minA;
         float maxB,minB;
 
         // Project vertices onto normal axis
-        projectAxis(verticesA,normalAxis,maxA,minA);
-        projectAxis(verticesB,normalAxis,maxB,minB);
+        projectAxis(a.vertices,a.count,normalAxis,maxA,minA);
+        projectAxis(b.vertices,b.count,normalAxis,maxB,minB);
       
-        if (maxA < minB || maxB < minA) { // A gap was found, so there the two vertices A and B ( / polygons ) are seperated.
+        if (maxA + margin < minB || maxB + margin < minA) { // A gap was found, so there the two vertices A and B ( / polygons ) are seperated.
+            separating = i;
             return false;
         }
 
@@ -163,41 +355,598 @@ bool SATLoop(const RigidBody& A,const RigidBody& B,float& penetration,Vec2& norm
 
 }
 
+#endif
+
+Manifold polygonManifold(const BodyStore& bodies,int A,int B,const SATPolygon& polygonA,const SATPolygon& polygonB,
+                         float penetration,Vec2 normal,bool referenceIsB,float margin) {
+
+    // Builds the manifold of two polygons SAT found overlapping ( or apart by at most margin ), shared by the generic
+    // and specialised kernels. normal is the axis of least penetration, in either direction, and referenceIsB says
+    // which polygon's face it came from.
+
+    if (vecMath::dot(normal, bodies.position[B] - bodies.position[A]) < 0.0f) {
+        normal = normal * -1;  // Ensure the normal always points from a to b to avoid merging objects 
+    }
+    contactResult contactData = referenceIsB ? clipContacts(polygonB, polygonA, normal * -1, margin)
+                                             : clipContacts(polygonA, polygonB, normal, margin); // Register the contact points 
+
+    Manifold manifold{ // Build a manifold to describe the outcome of the collision
+        A,
+        B,
+        normal,
+        contactData.contact1,
+        contactData.contact2,
+        contactData.contactCount,
+        penetration,
+        true,
+        { contactData.depth1, contactData.depth2 }
+    };
+
+    return manifold;
+
+}
+
 // Main SAT function, utilising helpers. Attempts to find a seperating axis to discern if two objects are touching or not.
-Manifold SATCollision(RigidBody& RigidBodyA,RigidBody& RigidBodyB) { 
+Manifold SATCollision(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis,float margin) { 
     
     // Separating Axis Theorem (SAT) collision test for two convex polygons.
     // Returns a Manifold with normal (A->B), penetration depth, and up to two contact points.
     // Preconditions: transformedVertices for both bodies are up-to-date.
 
+    (void)arena; // Contact clipping needs no scratch memory
+
+    const SATPolygon polygonA = satPolygon(bodies, A);
+    const SATPolygon polygonB = satPolygon(bodies, B);
+
     float penetration = std::numeric_limits<float>::infinity(); // Will yield as the smallest penetration
     Vec2 normal{0.0f,0.0f}; // Will yield as the normal for the smallest penetration
-    bool inCollision{true}; // Whether the two objects are in collision or not
+    int separating = -1; // Face that separated the polygons, if any
 
     // Evaluate all edge-normals of the polygons  
-    if (!SATLoop(RigidBodyA,RigidBodyB,penetration,normal)) inCollision=false;
-    if (!SATLoop(RigidBodyB,RigidBodyA,penetration,normal)) inCollision=false;
-    
-    contactResult contactData{};
+    if (!SATLoop(polygonA,polygonB,margin,penetration,normal,separating)) {
+        if (axis) *axis = SeparatingAxis{ separating, false };
+        return Manifold{ A, B };
+    }
+    const float penetrationA = penetration;
+    if (!SATLoop(polygonB,polygonA,margin,penetration,normal,separating)) {
+        if (axis) *axis = SeparatingAxis{ separating, true };
+        return Manifold{ A, B };
+    }
+
+    if (axis) *axis = SeparatingAxis{};
+    return polygonManifold(bodies,A,B,polygonA,polygonB,penetration,normal,penetration < penetrationA,margin); // B's face won if B's loop improved on A's
 
-    if (inCollision){
-        if (vecMath::dot(normal, RigidBodyB.position - RigidBodyA.position) < 0.0f) {
-            normal = normal * -1;  // Ensure the normal always points from a to b to avoid merging objects 
+}  
+
+// -- GJK / EPA
+
+// For polygons with many vertices ( see ShapeKind::Hull ). Every query goes through support functions, which hill
+// climb the vertex rings ( supportVertex() ), so a test costs O(log n + log m) per iteration instead of SAT's O(n * (n + m)).
+
+const int kGJKMaxIterations = 32;
+const int kEPAMaxIterations = 32;
+const float kEPATolerance = 1e-4f; // EPA stops once a support point improves the closest edge by less than this
+
+struct MinkowskiSupport{
+
+    // Support function of the Minkowski difference A - B. Remembers the last support vertex of each polygon, as
+    // consecutive GJK / EPA directions are usually close, so each climb starts near its answer.
+    // With a margin, A is grown by a disc of that radius, so pairs apart by less than it count as overlapping.
+
+    const SATPolygon& a;
+    const SATPolygon& b;
+    float margin{0.0f};
+    int lastA{0};
+    int lastB{0};
+
+    Vec2 operator()(const Vec2& direction) {
+        lastA = supportVertex(a, direction, lastA);
+        lastB = supportVertex(b, direction * -1, lastB);
+        Vec2 point = a.vertices[lastA] - b.vertices[lastB];
+        if (margin > 0.0f) point += direction * (margin / vecMath::length(direction));
+        return point;
+    }
+
+};
+
+Vec2 perpendicularTowards(const Vec2& edge, const Vec2& towards) {
+    Vec2 perpendicular(-edge.y, edge.x);
+    return (vecMath::dot(perpendicular, towards) < 0.0f) ? perpendicular * -1 : perpendicular;
+}
+
+bool GJK(MinkowskiSupport& support, Vec2 direction, Vec2 simplex[3]) {
+
+    // Returns true if A - B contains the origin ( the polygons overlap ), leaving a CCW triangle around the origin in simplex.
+    // Touching ( the origin on the simplex's boundary ) counts as apart, as there is nothing to resolve.
+
+    if (vecMath::lengthSquared(direction) < 1e-12f) direction = Vec2(1.0f, 0.0f);
+
+    simplex[0] = support(direction);
+    int count = 1;
+    direction = simplex[0] * -1;
+
+    for (int iteration = 0; iteration < kGJKMaxIterations; ++iteration) {
+
+        if (vecMath::lengthSquared(direction) < 1e-12f) return false; // Origin on the simplex
+
+        const Vec2 point = support(direction);
+        if (vecMath::dot(point, direction) <= 0.0f) return false; // A - B does not reach past the origin, so it excludes it
+        simplex[count++] = point;
+
+        const Vec2& a = simplex[count - 1]; // Newest point, the origin lies beyond the rest of the simplex from it
+        const Vec2 toOrigin = a * -1;
+
+        if (count == 2) { // Line, search perpendicular to it towards the origin
+            direction = perpendicularTowards(simplex[0] - a, toOrigin);
+            continue;
+        }
+
+        // Triangle: keep the edge through a that faces the origin, or stop if the origin is inside
+        const Vec2 ab = simplex[1] - a;
+        const Vec2 ac = simplex[0] - a;
+        const Vec2 abOut = perpendicularTowards(ab, ac * -1);
+        const Vec2 acOut = perpendicularTowards(ac, ab * -1);
+
+        if (vecMath::dot(abOut, toOrigin) > 0.0f) { // Drop c
+            simplex[0] = simplex[1];
+            simplex[1] = a;
+            count = 2;
+            direction = abOut;
+        } else if (vecMath::dot(acOut, toOrigin) > 0.0f) { // Drop b
+            simplex[1] = a;
+            count = 2;
+            direction = acOut;
+        } else {
+            if (vecMath::cross(simplex[1] - simplex[0], simplex[2] - simplex[0]) < 0.0f) std::swap(simplex[1], simplex[2]);
+            return true;
         }
-       contactData = getContactPoints(RigidBodyA,RigidBodyB); // If the object is in collision start to register the contact points 
+
     }
 
-    Manifold manifold{ // Build a manifold to describe the outcome of the collision
-        RigidBodyA,
-        RigidBodyB,
-        normal,
-        contactData.contact1,
-        contactData.contact2,
-        contactData.contactCount,
-        penetration,
-        inCollision
+    return false; // Did not converge, only possible for near-touching pairs
+
+}
+
+void EPA(MinkowskiSupport& support, const Vec2 simplex[3], FrameArena& arena, Vec2& normal, float& depth) {
+
+    // Expands GJK's triangle towards the boundary of A - B, to find its closest edge to the origin.
+    // That edge's outward normal is the direction of least penetration ( pointing A -> B ), its distance the depth.
+    // The polytope is scratch memory from the arena.
+
+    FrameVector<Vec2> polytope{ArenaAllocator<Vec2>(arena)};
+    polytope.reserve(3 + kEPAMaxIterations);
+    polytope.assign(simplex, simplex + 3);
+
+    for (int iteration = 0; iteration < kEPAMaxIterations; ++iteration) {
+
+        int closest = 0;
+        depth = std::numeric_limits<float>::infinity();
+        for (int i = 0; i < static_cast<int>(polytope.size()); ++i) { // Closest edge, the polytope is CCW so ( e.y, -e.x ) points out
+            const Vec2& a = polytope[i];
+            const Vec2 edge = polytope[(i + 1) % polytope.size()] - a;
+            const float length = vecMath::length(edge);
+            if (length < 1e-9f) continue;
+            const Vec2 edgeNormal(edge.y / length, -edge.x / length);
+            const float distance = vecMath::dot(edgeNormal, a);
+            if (distance < depth) {
+                depth = distance;
+                normal = edgeNormal;
+                closest = i;
+            }
+        }
+
+        const Vec2 point = support(normal);
+        if (vecMath::dot(point, normal) - depth < kEPATolerance) return; // The edge is on the boundary
+
+        polytope.insert(polytope.begin() + closest + 1, point);
+
+    }
+
+}
+
+Manifold GJKCollision(const BodyStore& bodies,int A,int B,FrameArena& arena,float margin) {
+
+    // GJK intersection test, EPA for the normal and depth, then the same clipping as the SAT kernels.
+    // The reference face is A's unless B has a face clearly better aligned with the normal.
+    // With a margin EPA measures the grown A ( see MinkowskiSupport ), whose depth exceeds the polygons' by margin.
+
+    const SATPolygon polygonA = satPolygon(bodies, A);
+    const SATPolygon polygonB = satPolygon(bodies, B);
+    MinkowskiSupport support{ polygonA, polygonB, margin };
+
+    Vec2 simplex[3];
+    if (!GJK(support, bodies.position[A] - bodies.position[B], simplex)) return Manifold{ A, B };
+
+    Vec2 normal{0.0f,0.0f};
+    float depth = 0.0f;
+    EPA(support, simplex, arena, normal, depth);
+    depth -= margin;
+
+    auto alignment = [](const SATPolygon& polygon, int face, const Vec2& direction) {
+        const Vec2& n = polygon.normals[face];
+        return vecMath::dot(Vec2(n.x * polygon.c - n.y * polygon.s, n.x * polygon.s + n.y * polygon.c), direction);
     };
+    const float alignmentA = alignment(polygonA, extremeFace(polygonA, normal), normal);
+    const float alignmentB = alignment(polygonB, extremeFace(polygonB, normal * -1), normal * -1);
+
+    return polygonManifold(bodies,A,B,polygonA,polygonB,depth,normal,alignmentB > alignmentA + 1e-3f,margin);
 
+}
+
+// -- Circle Detection
+
+Manifold CircleCollision(const BodyStore& bodies,int A,int B,float margin) {
+
+    // Circle-circle test: colliding when the centres are closer than the sum of the radii ( plus margin ).
+    // The contact lies halfway between the two surfaces along the centre line.
+
+    const float radiusA = bodies.shapeOf(A).radius;
+    const float radiusB = bodies.shapeOf(B).radius;
+    const float radii = radiusA + radiusB;
+    const float reach = radii + margin;
+
+    Manifold manifold{ A, B };
+
+    const Vec2 delta = bodies.position[B] - bodies.position[A];
+    const float distanceSq = vecMath::lengthSquared(delta);
+    if (distanceSq > reach * reach) return manifold;
+
+    const float distance = std::sqrt(distanceSq);
+    manifold.normal = (distance > 1e-6f) ? delta * (1.0f / distance) : Vec2(0.0f, 1.0f); // Concentric, any direction will do
+    manifold.penetration = radii - distance;
+    manifold.contact1 = bodies.position[A] + manifold.normal * (radiusA - manifold.penetration * 0.5f);
+    manifold.contactPenetration[0] = manifold.penetration;
+    manifold.contactCount = 1;
+    manifold.inCollision = true;
     return manifold;
 
-}  
+}
+
+template<int N>
+Manifold circlePolygon(const BodyStore& bodies,int A,int B,float margin) {
+
+    // Circle-polygon test against the polygon's cached world-space vertices.
+    // N is the polygon's vertex count when known at compile time ( the face loop is then fully unrolled ), 0 otherwise.
+    // Finds the face the centre is furthest in front of, then classifies the centre against that face's
+    // Voronoi regions: beyond either end vertex the closest feature is that vertex, otherwise the face itself.
+    // The contact is the closest point on the polygon's surface.
+
+    const bool circleIsA = bodies.shapeOf(A).type == Circle;
+    const int circle = circleIsA ? A : B;
+    const int polygon = circleIsA ? B : A;
+
+    Manifold manifold{ A, B };
+
+    const float radius = bodies.shapeOf(circle).radius;
+    const float reach = radius + margin; // Surfaces apart by up to margin still make a contact
+    const Vec2 centre = bodies.position[circle];
+    const SATPolygon poly = satPolygon(bodies, polygon);
+
+    float separation = -std::numeric_limits<float>::infinity();
+    int face = 0;
+    Vec2 faceNormal;
+    bool separated = !forEach<N>(poly.count, [&](int i) {
+        const Vec2& n = poly.normals[i];
+        Vec2 normalAxis(n.x * poly.c - n.y * poly.s, n.x * poly.s + n.y * poly.c);
+        float s = vecMath::dot(normalAxis, centre - poly.vertices[i]);
+        if (s > reach) return false; // Separating face
+        if (s > separation) {
+            separation = s;
+            face = i;
+            faceNormal = normalAxis;
+        }
+        return true;
+    });
+    if (separated) return manifold;
+
+    const Vec2& v1 = poly.vertices[face];
+    const Vec2& v2 = poly.vertices[(face + 1 == poly.count) ? 0 : face + 1];
+
+    Vec2 normal; // Polygon -> circle
+    Vec2 contact;
+
+    if (separation < 1e-6f) { // Centre inside the polygon, push out through the closest face
+        normal = faceNormal;
+        contact = centre - faceNormal * separation;
+        manifold.penetration = radius - separation;
+    } else if (vecMath::dot(centre - v1, v2 - v1) <= 0.0f) { // Beyond v1
+        float distanceSq = vecMath::distanceSquared(centre, v1);
+        if (distanceSq > reach * reach) return manifold;
+        float distance = std::sqrt(distanceSq);
+        normal = (centre - v1) * (1.0f / distance);
+        contact = v1;
+        manifold.penetration = radius - distance;
+    } else if (vecMath::dot(centre - v2, v1 - v2) <= 0.0f) { // Beyond v2
+        float distanceSq = vecMath::distanceSquared(centre, v2);
+        if (distanceSq > reach * reach) return manifold;
+        float distance = std::sqrt(distanceSq);
+        normal = (centre - v2) * (1.0f / distance);
+        contact = v2;
+        manifold.penetration = radius - distance;
+    } else { // In front of the face
+        normal = faceNormal;
+        contact = centre - faceNormal * separation;
+        manifold.penetration = radius - separation;
+    }
+
+    manifold.normal = circleIsA ? normal * -1 : normal; // Must point A -> B
+    manifold.contact1 = contact;
+    manifold.contactPenetration[0] = manifold.penetration;
+    manifold.contactCount = 1;
+    manifold.inCollision = true;
+    return manifold;
+
+}
+
+Manifold CirclePolygonCollision(const BodyStore& bodies,int A,int B,float margin) {
+    return circlePolygon<0>(bodies, A, B, margin);
+}
+
+// -- Specialised polygon kernels & dispatch
+
+// Polygon with a compile-time vertex count, of which only the first `axes` face normals are distinct SAT axes
+// ( a box's opposite faces share an axis, so it only needs 2 of its 4 )
+template<int V, int AX>
+struct FixedPolygon{
+    static constexpr int vertices = V;
+    static constexpr int axes = AX;
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+template<size_t... I>
+inline void projectAxes4Fixed(const Vec2* vertices,__m128 axisX,__m128 axisY,__m128& max,__m128& min,std::index_sequence<I...>){
+
+    // projectAxes4 for a compile-time vertex count, the fold expressions unroll it completely
+
+    const __m128 projection[] = { _mm_add_ps(_mm_mul_ps(_mm_set1_ps(vertices[I].x), axisX), _mm_mul_ps(_mm_set1_ps(vertices[I].y), axisY))... };
+    min = projection[0];
+    max = projection[0];
+    ((min = _mm_min_ps(min, projection[I]), max = _mm_max_ps(max, projection[I])), ...);
+
+}
+
+template<typename PA, int Axis>
+inline Vec2 fixedAxis(const SATPolygon& a,const SATPolygon& b){
+
+    // World-space SAT axis number Axis, counting a's distinct axes first and then b's
+
+    const SATPolygon& owner = (Axis < PA::axes) ? a : b;
+    const Vec2& n = owner.normals[(Axis < PA::axes) ? Axis : Axis - PA::axes];
+    return Vec2(n.x * owner.c - n.y * owner.s, n.x * owner.s + n.y * owner.c);
+
+}
+
+template<typename PA, typename PB, int Group>
+inline bool fixedSATGroup(const SATPolygon& a,const SATPolygon& b,float margin,float& penetration,Vec2& normal,int& best,int& separating){
+
+    // Tests axes [4 * Group, 4 * Group + 4) of the pair at once, every index is known at compile time.
+    // Lanes past the last axis repeat it, like SATLoop's trailing group.
+
+    constexpr int axes = PA::axes + PB::axes;
+    constexpr int first = 4 * Group;
+    constexpr int lanes = std::min(4, axes - first);
+
+    const Vec2 axis[4] = {
+        fixedAxis<PA, std::min(first + 0, axes - 1)>(a, b),
+        fixedAxis<PA, std::min(first + 1, axes - 1)>(a, b),
+        fixedAxis<PA, std::min(first + 2, axes - 1)>(a, b),
+        fixedAxis<PA, std::min(first + 3, axes - 1)>(a, b)
+    };
+    const __m128 axisX = _mm_setr_ps(axis[0].x, axis[1].x, axis[2].x, axis[3].x);
+    const __m128 axisY = _mm_setr_ps(axis[0].y, axis[1].y, axis[2].y, axis[3].y);
+
+    __m128 maxA,minA;
+    __m128 maxB,minB;
+    projectAxes4Fixed(a.vertices,axisX,axisY,maxA,minA,std::make_index_sequence<PA::vertices>{});
+    projectAxes4Fixed(b.vertices,axisX,axisY,maxB,minB,std::make_index_sequence<PB::vertices>{});
+
+    const __m128 gap = _mm_set1_ps(margin);
+    if (const int mask = _mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(_mm_add_ps(maxA, gap), minB), _mm_cmplt_ps(_mm_add_ps(maxB, gap), minA)))) { // Separated
+        int lane = 0;
+        while (!(mask & (1 << lane))) ++lane;
+        separating = first + std::min(lane, lanes - 1);
+        return false;
+    }
+
+    alignas(16) float depth[4];
+    _mm_store_ps(depth, _mm_min_ps(_mm_sub_ps(maxA, minB), _mm_sub_ps(maxB, minA)));
+    for (int l = 0; l < lanes; ++l) {
+        if (depth[l] < penetration) {
+            penetration = depth[l];
+            normal = axis[l];
+            best = first + l;
+        }
+    }
+    return true;
+
+}
+
+template<typename PA, typename PB, size_t... Group>
+inline bool fixedSATAxes(const SATPolygon& a,const SATPolygon& b,float margin,float& penetration,Vec2& normal,int& best,int& separating,
+                         std::index_sequence<Group...>){
+    return (fixedSATGroup<PA, PB, static_cast<int>(Group)>(a, b, margin, penetration, normal, best, separating) && ...);
+}
+
+template<typename PA, typename PB>
+Manifold fixedPolygons(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis,float margin) {
+
+    // SAT between two polygons of compile-time vertex counts.
+    // The distinct axes of both polygons ( A's first, then B's ) are packed 4 per register, so box-box ( the OBB
+    // test, 2 + 2 axes ) is a single pass over each box's 4 vertices. Every loop has a compile-time count and unrolls.
+    // Same semantics as SATCollision: no collision if any axis separates, otherwise the shallowest axis wins
+    // ( the first one on ties ).
+
+    const SATPolygon polygonA = satPolygon(bodies, A);
+    const SATPolygon polygonB = satPolygon(bodies, B);
+
+    constexpr int groups = (PA::axes + PB::axes + 3) / 4;
+
+    (void)arena;
+
+    float penetration = std::numeric_limits<float>::infinity();
+    Vec2 normal{0.0f,0.0f};
+    int best = 0; // Index of the winning axis, B's axes follow A's
+    int separating = 0;
+
+    if (!fixedSATAxes<PA, PB>(polygonA,polygonB,margin,penetration,normal,best,separating,std::make_index_sequence<groups>{})) {
+        if (axis) *axis = (separating < PA::axes) ? SeparatingAxis{ separating, false } : SeparatingAxis{ separating - PA::axes, true };
+        return Manifold{ A, B };
+    }
+
+    if (axis) *axis = SeparatingAxis{};
+    return polygonManifold(bodies,A,B,polygonA,polygonB,penetration,normal,best >= PA::axes,margin);
+
+}
+
+#else
+
+template<typename PA, typename PB>
+bool fixedSATAxes(const SATPolygon& a,const SATPolygon& b,float margin,float& penetration,Vec2& normal,int& separating) {
+
+    // Scalar fallback, SAT over a's distinct axes with every loop over a compile-time count so the whole test unrolls.
+    // Same semantics as SATLoop: false as soon as an axis separates ( setting separating ), otherwise keeps the shallowest axis.
+
+    return forEach<PA::axes>(PA::axes, [&](int i) {
+
+        const Vec2& n = a.normals[i];
+        const Vec2 axis(n.x * a.c - n.y * a.s, n.x * a.s + n.y * a.c);
+
+        float minA = std::numeric_limits<float>::infinity(), maxA = -minA;
+        forEach<PA::vertices>(PA::vertices, [&](int v) {
+            float p = vecMath::dot(a.vertices[v], axis);
+            minA = std::min(minA, p);
+            maxA = std::max(maxA, p);
+            return true;
+        });
+
+        float minB = std::numeric_limits<float>::infinity(), maxB = -minB;
+        forEach<PB::vertices>(PB::vertices, [&](int v) {
+            float p = vecMath::dot(b.vertices[v], axis);
+            minB = std::min(minB, p);
+            maxB = std::max(maxB, p);
+            return true;
+        });
+
+        if (maxA + margin < minB || maxB + margin < minA) {
+            separating = i;
+            return false;
+        }
+
+        float axisDepth = std::min(maxA - minB, maxB - minA);
+        if (axisDepth < penetration) {
+            penetration = axisDepth;
+            normal = axis;
+        }
+        return true;
+
+    });
+
+}
+
+template<typename PA, typename PB>
+Manifold fixedPolygons(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis,float margin) {
+
+    // SAT between two polygons of compile-time vertex counts ( box-box is the OBB test, 2 + 2 axes )
+
+    const SATPolygon polygonA = satPolygon(bodies, A);
+    const SATPolygon polygonB = satPolygon(bodies, B);
+
+    (void)arena;
+
+    float penetration = std::numeric_limits<float>::infinity();
+    Vec2 normal{0.0f,0.0f};
+
+    int separating = 0;
+
+    if (!fixedSATAxes<PA, PB>(polygonA,polygonB,margin,penetration,normal,separating)) {
+        if (axis) *axis = SeparatingAxis{ separating, false };
+        return Manifold{ A, B };
+    }
+    const float penetrationA = penetration;
+    if (!fixedSATAxes<PB, PA>(polygonB,polygonA,margin,penetration,normal,separating)) {
+        if (axis) *axis = SeparatingAxis{ separating, true };
+        return Manifold{ A, B };
+    }
+
+    if (axis) *axis = SeparatingAxis{};
+    return polygonManifold(bodies,A,B,polygonA,polygonB,penetration,normal,penetration < penetrationA,margin);
+
+}
+
+#endif
+
+// Compile-time description of each ShapeKind
+template<int K> struct KindTraits{ // Polygon3 .. Polygon8
+    static constexpr int vertices = K - static_cast<int>(ShapeKind::Polygon3) + 3;
+    using Polygon = FixedPolygon<vertices, vertices>;
+};
+template<> struct KindTraits<static_cast<int>(ShapeKind::Box)>{
+    static constexpr int vertices = 4;
+    using Polygon = FixedPolygon<4, 2>;
+};
+template<> struct KindTraits<static_cast<int>(ShapeKind::Circle)>{ static constexpr int vertices = 0; };
+template<> struct KindTraits<static_cast<int>(ShapeKind::Polygon)>{ static constexpr int vertices = 0; };
+template<> struct KindTraits<static_cast<int>(ShapeKind::Hull)>{ static constexpr int vertices = 0; };
+
+template<int KA, int KB>
+Manifold collideKinds(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis,float margin) {
+
+    // One cell of the dispatch matrix, every branch is resolved at compile time
+
+    constexpr int circle = static_cast<int>(ShapeKind::Circle);
+    constexpr int generic = static_cast<int>(ShapeKind::Polygon);
+    constexpr int hull = static_cast<int>(ShapeKind::Hull);
+
+    if constexpr (KA == circle || KB == circle) {
+        if (axis) *axis = SeparatingAxis{}; // Closed-form tests, nothing worth caching
+    }
+
+    if constexpr (KA == circle && KB == circle) {
+        return CircleCollision(bodies, A, B, margin);
+    } else if constexpr (KA == circle) {
+        return circlePolygon<KindTraits<KB>::vertices>(bodies, A, B, margin);
+    } else if constexpr (KB == circle) {
+        return circlePolygon<KindTraits<KA>::vertices>(bodies, A, B, margin);
+    } else if constexpr (KA == hull || KB == hull) {
+        if (axis) *axis = SeparatingAxis{}; // GJK finds no face to cache
+        return GJKCollision(bodies, A, B, arena, margin);
+    } else if constexpr (KA == generic || KB == generic) {
+        return SATCollision(bodies, A, B, arena, axis, margin);
+    } else {
+        return fixedPolygons<typename KindTraits<KA>::Polygon, typename KindTraits<KB>::Polygon>(bodies, A, B, arena, axis, margin);
+    }
+
+}
+
+using CollideFn = Manifold(*)(const BodyStore&,int,int,FrameArena&,SeparatingAxis*,float);
+constexpr int kKinds = static_cast<int>(ShapeKind::Count);
+
+template<int KA, size_t... KB>
+constexpr std::array<CollideFn, kKinds> dispatchRow(std::index_sequence<KB...>) {
+    return {{ &collideKinds<KA, static_cast<int>(KB)>... }};
+}
+
+template<size_t... KA>
+constexpr std::array<std::array<CollideFn, kKinds>, kKinds> dispatchTable(std::index_sequence<KA...>) {
+    return {{ dispatchRow<static_cast<int>(KA)>(std::make_index_sequence<kKinds>{})... }};
+}
+
+constexpr auto kDispatch = dispatchTable(std::make_index_sequence<kKinds>{}); // [kind of A][kind of B]
+
+Manifold collide(const BodyStore& bodies,int A,int B,FrameArena& arena,SeparatingAxis* axis,float margin) {
+
+    const ShapeKind kindA = bodies.shapeOf(A).kind;
+    const ShapeKind kindB = bodies.shapeOf(B).kind;
+
+    if (axis && axis->face >= 0 && kindA != ShapeKind::Circle && kindB != ShapeKind::Circle) { // Retry the cached axis first
+        const SATPolygon polygonA = satPolygon(bodies, A);
+        const SATPolygon polygonB = satPolygon(bodies, B);
+        const SATPolygon& owner = axis->onB ? polygonB : polygonA;
+        const SATPolygon& other = axis->onB ? polygonA : polygonB;
+        if (axis->face < owner.count && separatesOn(owner, other, axis->face, margin)) return Manifold{ A, B }; // Still apart, axis unchanged
+    }
+
+    return kDispatch[static_cast<int>(kindA)][static_cast<int>(kindB)](bodies, A, B, arena, axis, margin);
+
+}
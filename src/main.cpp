@@ -17,7 +17,7 @@ int main() {
     floor.rotate(1.5708f);
     floor.colour = Colour{150.0f, 255.0f, 255.0f};
     floor.restitution = 1.0f;
-    world.getBodies().push_back(floor);
+    world.addBody(floor);
 
     RigidBody incline;
     setBoxVertices(incline, 10.0f, 0.8f);
@@ -26,9 +26,9 @@ int main() {
     incline.rotate(1.5708f * -0.05f);
     incline.colour = Colour{150.0f, 255.0f, 255.0f};
     incline.restitution = 1.0f;
-    //world.getBodies().push_back(incline);
+    //world.addBody(incline);
 
-    // Static box pegs in plinko arrangement
+    // Static circle pegs in plinko arrangement
     const int rows = 10;
     const int pegsPerRow = 8;
     const float startY = 13.0f;
@@ -45,7 +45,9 @@ int main() {
 
             float x = -10.0f + col * colSpacing + xOffset;
 
-            RigidBody peg(25,0.4f,1.0f);
+            RigidBody peg;
+            setCircle(peg, 0.4f);
+            peg.mass = 1.0f;
             peg.setStatic(true);
             peg.snapTo(Vec2(x, y));
             peg.colour = Colour{255.0f, 255.0f, 255.0f};
@@ -53,7 +55,7 @@ int main() {
             peg.staticFriction = 0.0f;
             peg.dynamicFriction = 0.0f;
 
-            world.getBodies().push_back(peg);
+            world.addBody(peg);
 
         }
     }
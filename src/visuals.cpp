@@ -3,6 +3,8 @@
 
 #include "visuals/Visuals.hpp"
 #include "core/Transform.hpp"
+#include "math/Math.hpp"
+#include <cmath>
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -122,12 +124,13 @@ Visuals::~Visuals(){
 }
 
 std::vector<float> buffer{};
+const int kCircleSegments = 32; // Outline resolution of circles, render-only
 
-void Visuals::drawRigidBody(const RigidBody& body){
+void Visuals::drawBody(const BodyStore& bodies, int i){
 
-    // Draws a single rigid body using the active shader and geometry buffers.
+    // Draws a single body using the active shader and geometry buffers.
     // Assumes the body's world-space vertices are up-to-date.
-    // Body is const, does not modify physics state.
+    // Bodies are const, does not modify physics state.
    
     if (!m_ok) return;
 
@@ -142,18 +145,34 @@ void Visuals::drawRigidBody(const RigidBody& body){
 
     // Flatten world-space vertices into a float buffer
     buffer.clear();
-    
-    for (const Vec2& v : body.transformedVertices) {
-        buffer.push_back(v.x);
-        buffer.push_back(v.y);
+
+    const Shape& shape = bodies.shapeOf(i);
+    int count = 0;
+
+    if (shape.type == Circle) { // Circles have no vertices, draw a render-only outline starting at the body's rotation
+        count = kCircleSegments;
+        for (int k = 0; k < count; ++k) {
+            float theta = bodies.rotation[i] + 2.0f * vecMath::pi * k / count;
+            buffer.push_back(bodies.position[i].x + shape.radius * std::cos(theta));
+            buffer.push_back(bodies.position[i].y + shape.radius * std::sin(theta));
+        }
+    } else {
+        const Vec2* vertices = bodies.verticesOf(i);
+        count = static_cast<int>(bodies.vertexCount[i]);
+        for (int k = 0; k < count; ++k) {
+            const Vec2& v = vertices[k];
+            buffer.push_back(v.x);
+            buffer.push_back(v.y);
+        }
     }
 
-    // Set colour for this body
+    // Set colour for this body, read from the cold side table
+    const Colour& colour = bodies.info[i].colour;
     glUniform3f(
         m_colourLoc,
-        body.colour.r,
-        body.colour.g,
-        body.colour.b
+        colour.r,
+        colour.g,
+        colour.b
     );
 
     glBindVertexArray(m_vao);
@@ -176,7 +195,7 @@ void Visuals::drawRigidBody(const RigidBody& body){
         (void*)0
     );
 
-    glDrawArrays(GL_TRIANGLE_FAN, 0, static_cast<GLsizei>(body.transformedVertices.size()));
+    glDrawArrays(GL_TRIANGLE_FAN, 0, static_cast<GLsizei>(count));
 
     glBindVertexArray(0);
 
@@ -210,16 +229,17 @@ void Visuals::mouseButtonCallback(GLFWwindow* window, int button, int action, in
         yNDC / visuals->m_zoom
     };
 
-    RigidBody body(25, 0.6f, 1.0f);
+    RigidBody body;
+    setCircle(body, 0.6f);
+    body.mass = 1.0f;
     body.snapTo(worldPos);
-    body.update = true;       
     body.rotate(1.5708*1.5f);         
     body.staticFriction=0.0;
     body.dynamicFriction=0.0;
     body.colour = Colour{0.0f, 255.0f, 255.0f};
     body.restitution = 0.25f;
 
-    visuals->world.getBodies().push_back(body);
+    visuals->world.addBody(body);
 
 }
 
@@ -272,8 +292,10 @@ void Visuals::renderLoop(){
         glUniform1f(m_zoomLoc, m_zoom);
 
         // Draw each rigid body in the world  
-        for (auto& body:world.getBodies()){
-            drawRigidBody(body);
+        world.updateVertices(); // Vertices lazy transforms skipped
+        const BodyStore& bodies = world.getBodies();
+        for (int i = 0; i < bodies.size(); ++i){
+            drawBody(bodies, i);
         }
 
         glfwSwapBuffers(m_window);
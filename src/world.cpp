@@ -8,204 +8,1195 @@
 #include "core/Transform.hpp"
 #include "collision/AABB.hpp"
 #include "collision/Partitioning.hpp"
+#include "collision/Broadphase.hpp"
+#include "collision/DynamicTree.hpp"
+#include "collision/SweepAndPrune.hpp"
+#include "collision/PairCache.hpp"
+#include "memory/FrameArena.hpp"
+#include "memory/AllocationCounter.hpp"
+#include "jobs/JobSystem.hpp"
 #include <cmath>
 #include <algorithm>
+#include <limits>
 #include <iostream>
 #include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+struct ContactConstraint {
+
+    // Solver view of one Manifold, built once per step by prepareContacts().
+    // Impulses are accumulated over the iterations ( and warm started from the previous step ), and the
+    // accumulated totals are clamped rather than each iteration's delta.
+
+    int A;
+    int B;
+    Vec2 normal; // A -> B
+    Vec2 tangent;
+    int contactCount;
+    Vec2 rA[2]; // Contact point relative to each COM
+    Vec2 rB[2];
+    float normalMass[2]; // Effective mass along the normal / tangent
+    float tangentMass[2];
+    float velocityBias[2]; // Target separating velocity from restitution
+    float normalImpulse[2]; // Accumulated impulses
+    float tangentImpulse[2];
+    float staticFriction;
+    float dynamicFriction;
+    float separation[2]; // Signed distance of each contact at detection, negative when overlapping
+    Vec2 anchorA[2]; // Contact point in each body's frame at detection
+    Vec2 anchorB[2];
 
-struct impulseManifold {
-    Vec2 impulse;
-    Vec2 rA;
-    Vec2 rB;
 };
 
-Manifold narrowPhase(RigidBody& A, RigidBody& B) {
-    // Narrow phase collision detection only
-    // Returns a manifold, caller checks m.inCollision
-    return SATCollision(A, B);
+struct StartPose {
+
+    // A body's pose and velocity before this step's integration, kept by slot for SolverMode::Substeps,
+    // which detects contacts at the integrated pose and then substeps from this one
+
+    Vec2 position;
+    Vec2 linearVelocity;
+    float rotation;
+    float rotorCos;
+    float rotorSin;
+    uint8_t moved; // Integrated this step ( bodies woken later in the step start where they are )
+    float skipped; // Fraction of the step already covered, where CCD placed the body along its motion
+
+};
+
+const float kRestitutionThreshold = 0.5f; // Approach speeds below this do not bounce, so resting contacts stay still
+const float kContactMatchDistance = 0.1f; // Max anchor drift for a contact to inherit last step's impulses
+
+using AxisOutput = FrameVector<std::pair<uint64_t, SeparatingAxis>>; // Separating axes found this step, by slot pair key
+
+Manifold narrowPhase(const BodyStore& bodies, int A, int B, FrameArena& arena, float margin,
+                     const PairCache<SeparatingAxis>& axisCache, AxisOutput& axes, int& axisHits, int& axisMisses) {
+
+    // Narrow phase collision detection only, the kernel is picked from the two shapes' kinds
+    // Returns a manifold, caller checks m.inCollision ( pairs apart by up to margin are speculative contacts )
+    // A polygon pair that was apart last step tests last step's separating axis first ( a hit when it still
+    // separates them, a miss otherwise ), and a pair found apart appends its separating axis to axes.
+    // Cached axes are stored relative to the pair's lower-slot body, as the pair's A / B order may change.
+
+    const uint64_t key = partioning::pairKey(static_cast<int>(bodies.slot[A]), static_cast<int>(bodies.slot[B]));
+    const bool swapped = bodies.slot[A] > bodies.slot[B];
+
+    SeparatingAxis axis;
+    if (const SeparatingAxis* cached = axisCache.find(key)) {
+        axis = *cached;
+        axis.onB = axis.onB != swapped;
+    }
+    const SeparatingAxis tried = axis;
+
+    Manifold m = collide(bodies, A, B, arena, &axis, margin);
+
+    if (tried.face >= 0) { // The full test never returns the axis the retry already rejected
+        if (axis.face == tried.face && axis.onB == tried.onB) axisHits++;
+        else axisMisses++;
+    }
+    if (axis.face >= 0) {
+        axis.onB = axis.onB != swapped;
+        axes.push_back({ key, axis });
+    }
+
+    return m;
+
 }
 
-void broadPhase(std::vector<RigidBody>& bodies,std::vector<Manifold>& manifolds,WorldStats& m_stats) {
+struct NarrowChunk {
 
-    // Broad-phase collision detection.
-    // Builds candidate pairs from AABBs & Spatial grid partioning, runs narrow phase once per candidate,
-    // and stores colliding manifolds for later solver iterations
+    // Where one chunk of candidate pairs left its manifolds and separating axes, so outputs can be merged in chunk order
 
-    std::vector<AABB> aabbs;
-    aabbs.reserve(bodies.size());
+    int thread;
+    int first; // Offset into that thread's manifold output
+    int count;
+    int axisFirst; // Offset into that thread's separating axis output
+    int axisCount;
+    int broadChecks;
+    int narrowChecks;
+    int axisHits;
+    int axisMisses;
 
-    for (auto& body : bodies) {
-        physEng::worldSpace(body);
-        aabbs.emplace_back(getAABB(body));
+};
+
+const size_t kWorkerArenaBytes = 1 << 16; // Initial size of each worker's arena, they grow to fit like m_frameArena
+const int kBodyGrain = 128; // Bodies per job chunk when transforming / bounding
+const int kPairGrain = 64; // Candidate pairs per job chunk in the narrowphase
+
+void broadPhase(BodyStore& bodies,partioning::Broadphase& backend,const partioning::StaticGrid& statics,
+                const partioning::RestingGrid& sleeping,float dt,bool lazyTransforms,
+                float margin,FrameVector<Manifold>& manifolds,FrameVector<int>& touchedSleepers,FrameArena& arena,
+                JobSystem& jobs,std::vector<FrameArena>& workerArenas,PairCache<SeparatingAxis>& axisCache,
+                bool deterministic,WorldStats& m_stats) {
+
+    // Broad-phase collision detection.
+    // Builds candidate pairs of awake bodies with the World's broadphase backend, runs narrow phase once
+    // per candidate, and stores colliding manifolds for later solver iterations
+    // Static bodies are not inserted, awake bodies query them through the baked static grid instead, so
+    // static-static candidates are never produced ( and statics are never re-transformed or re-bounded ).
+    // Sleeping bodies are not inserted, awake bodies query them through the persistent sleeping grid instead.
+    // Sleeping bodies found in contact are appended to touchedSleepers so the World can wake their islands.
+    // All scratch memory is taken from the step's frame arena, and from workerArenas[t - 1] on worker thread t.
+    // Polygon pairs found apart store their separating axis in axisCache, to be tried first next step ( see narrowPhase() ).
+    // With a speculative margin, awake bodies' bounds are grown by it, so pairs apart by up to margin are still candidates.
+
+    // Lazy transforms:
+    // - Moving bodies are bounded from their transform alone ( physEng::lazyBounds() ), and their world-space vertices
+    //   are only transformed once they are in a candidate pair whose AABBs intersect, or touch a sleeper.
+    // - Until then their cached vertices are stale ( update stays set ), see World::updateVertices().
+
+    // Parallel stages ( over jobs ):
+    // - Vertex transformation ( or lazy bounds ) and AABB per body, each body only writes its own entries
+    // - In lazy mode, vertex transformation of the bodies left in a pair after the AABB cull
+    // - Whatever the backend spreads over jobs ( see Broadphase.hpp )
+    // - Narrowphase per chunk of candidate pairs, each thread appends to its own manifold output
+    // The merge of the manifold outputs ( in chunk order, so the result does not depend on the number of threads
+    // or on scheduling ), and the static and sleeping grid queries stay on the calling thread.
+
+    // Deterministic mode:
+    // - Pair order otherwise follows the backend's: the grid's cell order ( which shifts with its tuned cell size ), or
+    //   the tree's and sweep-and-prune's state, which depends on their insertion history. So the same scene run with
+    //   another backend, or rebuilt from a different history, orders its contacts differently. In deterministic mode
+    //   every pair is oriented lower slot first and the pairs are sorted by their slot pair key ( the World then sorts
+    //   the manifolds the same way, see sortManifolds() ).
+
+    const int count = bodies.size();
+
+    FrameVector<int> proxies{ArenaAllocator<int>(arena)}; // Dense index of every awake body
+    proxies.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        if (bodies.isStatic[i] || !bodies.awake[i]) continue; // Static or asleep, neither transformed nor inserted
+        proxies.push_back(i);
     }
 
-    partioning::GridConfig gridConfig;
-    auto pairs = partioning::buildPairsFromAABBs(aabbs, gridConfig); // Generate broad-phase pairs
+    const int proxyCount = static_cast<int>(proxies.size());
+    jobs.parallelFor(proxyCount, kBodyGrain, [&](int begin, int end) {
+        for (int a = begin; a < end; ++a) {
+            const int i = proxies[a];
+            if (!bodies.update[i]) continue; // Only bodies that moved need new vertices and bounds
+            if (lazyTransforms) {
+                bodies.bounds[i] = physEng::lazyBounds(bodies, i); // Vertices stay stale for now
+            } else {
+                physEng::worldSpace(bodies, i);
+                bodies.bounds[i] = physEng::worldBounds(bodies, i);
+            }
+            if (margin > 0.0f) {
+                bodies.bounds[i].min -= Vec2(margin, margin);
+                bodies.bounds[i].max += Vec2(margin, margin);
+            }
+        }
+    });
+
+    auto pairs = backend.findPairs(bodies, proxies, dt, jobs, arena); // Generate broad-phase pairs ( body indices )
     // likely to be in collision
 
-    for (const auto& [i, j] : pairs) {
+    if (!statics.empty()) { // Awake bodies against static ones
+        FrameVector<uint32_t> candidates{ArenaAllocator<uint32_t>(arena)};
+        for (int i : proxies) {
+            candidates.clear();
+            statics.query(bodies.bounds[i], candidates);
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end()); // Statics spanning several cells
+            for (uint32_t slot : candidates) {
+                const int j = bodies.indexOfSlot(slot);
+                if (AABBintersection(bodies.bounds[i], bodies.bounds[j])) {
+                    pairs.push_back({ i, j }); // Counted as a broad check by the narrowphase loop
+                } else {
+                    m_stats.broadChecks++; // Most cell mates are apart, culled before they reach the pair list
+                }
+            }
+        }
+    }
+
+    if (lazyTransforms) { // Cull pairs apart, then transform only the bodies still in a pair
+
+        FrameVector<uint8_t> queued(count, 0, ArenaAllocator<uint8_t>(arena));
+        FrameVector<int> transform{ArenaAllocator<int>(arena)};
+        auto queue = [&](int i) {
+            if (!bodies.update[i] || queued[i]) return;
+            queued[i] = 1;
+            transform.push_back(i);
+        };
+
+        size_t kept = 0;
+        for (const auto& p : pairs) {
+            if (!AABBintersection(bodies.bounds[p.first], bodies.bounds[p.second])) {
+                m_stats.broadChecks++; // Counted here when culled, by the narrowphase loop otherwise
+                continue;
+            }
+            queue(p.first);
+            queue(p.second);
+            pairs[kept++] = p;
+        }
+        pairs.resize(kept);
+
+        jobs.parallelFor(static_cast<int>(transform.size()), kBodyGrain, [&](int begin, int end) {
+            for (int t = begin; t < end; ++t) physEng::worldSpace(bodies, transform[t]);
+        });
+
+    }
+
+    if (deterministic) {
+        auto slotKey = [&](const std::pair<int,int>& p) {
+            return partioning::pairKey(static_cast<int>(bodies.slot[p.first]), static_cast<int>(bodies.slot[p.second]));
+        };
+        for (auto& p : pairs) {
+            if (bodies.slot[p.first] > bodies.slot[p.second]) std::swap(p.first, p.second);
+        }
+        std::sort(pairs.begin(), pairs.end(), [&](const auto& x, const auto& y) { return slotKey(x) < slotKey(y); });
+    }
+
+    // One manifold and one separating axis output per thread, each living in that thread's arena
+    const int threads = jobs.threadCount();
+    using ManifoldOutput = FrameVector<Manifold>;
+    using AxisEntry = std::pair<uint64_t, SeparatingAxis>;
+    FrameVector<ManifoldOutput> outputs{ArenaAllocator<ManifoldOutput>(arena)};
+    FrameVector<AxisOutput> axisOutputs{ArenaAllocator<AxisOutput>(arena)};
+    outputs.reserve(threads);
+    axisOutputs.reserve(threads);
+    outputs.emplace_back(ArenaAllocator<Manifold>(arena));
+    axisOutputs.emplace_back(ArenaAllocator<AxisEntry>(arena));
+    for (int t = 1; t < threads; ++t) {
+        outputs.emplace_back(ArenaAllocator<Manifold>(workerArenas[t - 1]));
+        axisOutputs.emplace_back(ArenaAllocator<AxisEntry>(workerArenas[t - 1]));
+    }
+
+    const int pairCount = static_cast<int>(pairs.size());
+    FrameVector<NarrowChunk> chunks((pairCount + kPairGrain - 1) / kPairGrain, NarrowChunk{}, ArenaAllocator<NarrowChunk>(arena));
+
+    jobs.parallelFor(pairCount, kPairGrain, [&](int begin, int end) {
+
+        const int thread = JobSystem::currentThread();
+        FrameArena& scratch = (thread == 0) ? arena : workerArenas[thread - 1];
+        ManifoldOutput& output = outputs[thread];
+        AxisOutput& axisOutput = axisOutputs[thread];
+
+        NarrowChunk& chunk = chunks[begin / kPairGrain];
+        chunk = NarrowChunk{ thread, static_cast<int>(output.size()), 0, static_cast<int>(axisOutput.size()), 0, 0, 0, 0, 0 };
+
+        for (int p = begin; p < end; ++p) {
+
+            chunk.broadChecks++;
+
+            const int i = pairs[p].first;
+            const int j = pairs[p].second;
+
+            if (!AABBintersection(bodies.bounds[i], bodies.bounds[j])) continue; // Cannot be colliding, AABB's dont intersect 
+
+            chunk.narrowChecks++;
+
+            Manifold m = narrowPhase(bodies, i, j, scratch, margin, axisCache, axisOutput, chunk.axisHits, chunk.axisMisses); // At this point, it's worth running SAT 
+
+            if (m.inCollision) {
+                output.push_back(std::move(m)); // Add manifold to this thread's output 
+            }
+
+        }
+
+        chunk.count = static_cast<int>(output.size()) - chunk.first;
+        chunk.axisCount = static_cast<int>(axisOutput.size()) - chunk.axisFirst;
+
+    });
+
+    for (const NarrowChunk& chunk : chunks) { // Merge in chunk order, identical to a serial run
+        const ManifoldOutput& output = outputs[chunk.thread];
+        manifolds.insert(manifolds.end(), output.begin() + chunk.first, output.begin() + chunk.first + chunk.count);
+        const AxisOutput& axisOutput = axisOutputs[chunk.thread];
+        for (int e = chunk.axisFirst; e < chunk.axisFirst + chunk.axisCount; ++e) axisCache.store(axisOutput[e].first, axisOutput[e].second);
+        m_stats.broadChecks += chunk.broadChecks;
+        m_stats.narrowChecks += chunk.narrowChecks;
+        m_stats.axisCacheHits += chunk.axisHits;
+        m_stats.axisCacheMisses += chunk.axisMisses;
+    }
+
+    if (sleeping.empty()) return;
+
+    // Awake bodies against sleeping ones
+    FrameVector<uint32_t> candidates{ArenaAllocator<uint32_t>(arena)};
+    AxisOutput sleeperAxes{ArenaAllocator<AxisEntry>(arena)};
+    int axisHits = 0;
+    int axisMisses = 0;
+
+    for (int i : proxies) {
+
+        candidates.clear();
+        sleeping.query(bodies.bounds[i], candidates);
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end()); // Sleepers spanning several cells
+
+        for (uint32_t slot : candidates) {
+
+            m_stats.broadChecks++;
+
+            const int j = bodies.indexOfSlot(slot);
+            if (!AABBintersection(bodies.bounds[i], bodies.bounds[j])) continue;
+
+            m_stats.narrowChecks++;
+
+            physEng::worldSpace(bodies, i); // No-ops unless skipped by lazy transforms
+            physEng::worldSpace(bodies, j);
+
+            const bool flip = deterministic && bodies.slot[i] > bodies.slot[j]; // Keep the lower slot as A
+            Manifold m = flip ? narrowPhase(bodies, j, i, arena, margin, axisCache, sleeperAxes, axisHits, axisMisses)
+                              : narrowPhase(bodies, i, j, arena, margin, axisCache, sleeperAxes, axisHits, axisMisses);
+
+            if (m.inCollision) {
+                manifolds.push_back(std::move(m));
+                touchedSleepers.push_back(j);
+            }
+
+        }
+
+    }
+
+    for (const AxisEntry& entry : sleeperAxes) axisCache.store(entry.first, entry.second);
+    m_stats.axisCacheHits += axisHits;
+    m_stats.axisCacheMisses += axisMisses;
+
+}
+
+const float kCCDMotionFraction = 0.5f; // Bodies moving further than this fraction of their inner radius in one step are swept
+const int kCCDMaxSamples = 64; // Poses tested along one sweep at most
+const int kCCDBisections = 6; // Refinements of the first overlapping pose
+const int kCCDGrain = 16; // Fast bodies per job chunk
+const int kCCDMaxHeldSteps = 8; // Consecutive steps a body's approach into a touched static may be removed
+
+struct CCDPlacement {
+    int body;
+    float time; // Fraction of the step's motion the body was left at, 1 for a re-integrated end pose
+};
+
+void continuousCollision(BodyStore& bodies, const partioning::StaticGrid& statics, float dt, FrameArena& arena, JobSystem& jobs,
+                         std::vector<FrameArena>& workerArenas, FrameVector<CCDPlacement>& placed, WorldStats& m_stats) {
+
+    // Continuous collision detection of fast bodies against static ones, run between integration and the broadphase.
+    // A body is fast when its motion this step ( linear, plus angular at its bounding radius ) exceeds kCCDMotionFraction
+    // of its inner radius, only then could the discrete test miss a thin static or find it deep past its centre.
+    // For each fast body:
+    // - The step's motion is swept back from the integrated pose ( start = end - velocity * dt ), and the static grid
+    //   is queried with the swept AABB, the union of the bounding circle's boxes at both ends.
+    // - Statics already touching at the start pose are left to the discrete solver, unless the body is still driving
+    //   into one fast enough to pass through it ( e.g. a spinning box the last contact only slowed ). Then that approach
+    //   is removed from its velocity, its end pose re-integrated and the sweep gathered again, for at most
+    //   kCCDMaxHeldSteps consecutive steps ( bodies.ccdHeld ), after which the pair is left to the discrete solver too.
+    // - Poses along the sweep are tested, no further apart than the inner radius so no static is stepped over. The first
+    //   overlapping pose is refined by bisection, and the body is moved back to the earliest overlapping pose found
+    //   ( time of impact ), where the broadphase then finds the contact and the solver removes the closing velocity.
+    // Only statics are swept, fast bodies against other dynamic bodies are left to the discrete test.
+    // Bodies only write their own pose and vertices, so fast bodies are swept in parallel, with per-thread scratch.
+    // A body that hits nothing is restored to its exact integrated pose, the others are appended to placed.
+
+    if (statics.empty()) return;
+
+    FrameVector<int> fast{ArenaAllocator<int>(arena)};
+    for (int i = 0; i < bodies.size(); ++i) {
+        if (bodies.isStatic[i] || !bodies.awake[i]) continue;
+        const Shape& shape = bodies.shapeOf(i);
+        const float motion = (bodies.linearVelocity[i].length() + std::abs(bodies.angularVelocity[i]) * shape.boundingRadius) * dt;
+        if (motion > kCCDMotionFraction * shape.innerRadius) fast.push_back(i);
+        else bodies.ccdHeld[i] = 0;
+    }
+    if (fast.empty()) return;
+
+    const int fastCount = static_cast<int>(fast.size());
+    FrameVector<float> placedAt(fastCount, -1.0f, ArenaAllocator<float>(arena)); // Negative when restored
+
+    jobs.parallelFor(fastCount, kCCDGrain, [&](int begin, int end) {
+
+        const int thread = JobSystem::currentThread();
+        FrameArena& scratch = (thread == 0) ? arena : workerArenas[thread - 1];
+        FrameVector<uint32_t> candidates{ArenaAllocator<uint32_t>(scratch)};
+
+        for (int f = begin; f < end; ++f) {
+
+            const int i = fast[f];
+            const Shape& shape = bodies.shapeOf(i);
+            const float radius = shape.boundingRadius;
+
+            Vec2 endPosition = bodies.position[i];
+            const float endRotation = bodies.rotation[i];
+            const float endCos = bodies.rotorCos[i];
+            const float endSin = bodies.rotorSin[i];
+            const Vec2 startPosition = endPosition - bodies.linearVelocity[i] * dt;
+            const float startRotation = endRotation - bodies.angularVelocity[i] * dt;
+
+            auto circleBounds = [&](const Vec2& c) { return AABB{ Vec2(c.x - radius, c.y - radius), Vec2(c.x + radius, c.y + radius) }; };
+            auto setPose = [&](float t) {
+                bodies.position[i] = startPosition + (endPosition - startPosition) * t;
+                bodies.rotation[i] = startRotation + (endRotation - startRotation) * t;
+                bodies.rotorCos[i] = std::cos(bodies.rotation[i]);
+                bodies.rotorSin[i] = std::sin(bodies.rotation[i]);
+                bodies.update[i] = 1;
+                physEng::worldSpace(bodies, i);
+            };
+            auto overlapsAny = [&]() { // Against the candidates, at the current pose
+                const AABB box = circleBounds(bodies.position[i]);
+                for (uint32_t slot : candidates) {
+                    const int j = bodies.indexOfSlot(slot);
+                    if (AABBintersection(box, bodies.bounds[j]) && collide(bodies, i, j, scratch).inCollision) return true;
+                }
+                return false;
+            };
+
+            // -- Statics within the swept AABB, that do not touch the body at the start pose. Removing the approach into
+            // a touched static changes the end pose, so the sweep is gathered again ( once, a second removal keeps it ).
+
+            bool held = false;
+            AABB swept;
+            for (int pass = 0; pass < 2; ++pass) {
+
+                const AABB startBox = circleBounds(startPosition);
+                const AABB endBox = circleBounds(endPosition);
+                swept = AABB{ Vec2(std::min(startBox.min.x, endBox.min.x), std::min(startBox.min.y, endBox.min.y)),
+                              Vec2(std::max(startBox.max.x, endBox.max.x), std::max(startBox.max.y, endBox.max.y)) };
+
+                candidates.clear();
+                statics.query(swept, candidates);
+                std::sort(candidates.begin(), candidates.end());
+                candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end()); // Statics spanning several cells
+
+                setPose(0.0f);
+                bool clamped = false;
+                size_t kept = 0;
+                for (uint32_t slot : candidates) {
+                    const int j = bodies.indexOfSlot(slot);
+                    if (!AABBintersection(swept, bodies.bounds[j])) continue;
+                    if (AABBintersection(startBox, bodies.bounds[j])) {
+                        const Manifold m = collide(bodies, i, j, scratch);
+                        if (m.inCollision) { // Touching already
+                            const float closing = vecMath::dot(bodies.linearVelocity[i], m.normal);
+                            if (closing * dt > kCCDMotionFraction * shape.innerRadius && bodies.ccdHeld[i] < kCCDMaxHeldSteps) {
+                                bodies.linearVelocity[i] -= m.normal * closing; // ... and still driving into it
+                                clamped = true;
+                            }
+                            continue;
+                        }
+                    }
+                    candidates[kept++] = slot;
+                }
+                candidates.resize(kept);
+
+                if (!clamped) break;
+                held = true;
+                endPosition = startPosition + bodies.linearVelocity[i] * dt;
+
+            }
+            bodies.ccdHeld[i] = held ? static_cast<uint8_t>(bodies.ccdHeld[i] + 1) : 0;
+
+            float impact = 1.0f;
+
+            // -- Step along the sweep to the first overlapping pose, then bisect towards the time of impact
+
+            if (!candidates.empty()) {
 
-        m_stats.broadChecks++;
+                const float motion = (endPosition - startPosition).length() + std::abs(endRotation - startRotation) * radius;
+                const float spacing = std::max(shape.innerRadius, 1e-4f);
+                const int samples = std::max(1, static_cast<int>(std::min(static_cast<float>(kCCDMaxSamples), std::ceil(motion / spacing))));
 
-        RigidBody& A = bodies[i];
-        RigidBody& B = bodies[j];
+                for (int k = 1; k <= samples; ++k) {
+                    const float t = static_cast<float>(k) / samples;
+                    setPose(t);
+                    if (!overlapsAny()) continue;
 
-        if (A.isStatic && B.isStatic) continue; // Both bodies static, no collision detection/resolution needed
-        if (!AABBintersection(aabbs[i], aabbs[j])) continue; // Cannot be colliding, AABB's dont intersect 
+                    float lo = static_cast<float>(k - 1) / samples; // Apart here
+                    float hi = t; // Overlapping here
+                    for (int b = 0; b < kCCDBisections; ++b) {
+                        const float mid = 0.5f * (lo + hi);
+                        setPose(mid);
+                        if (overlapsAny()) hi = mid; else lo = mid;
+                    }
+                    impact = hi;
+                    break;
+                }
 
-        m_stats.narrowChecks++;
+            }
 
-        Manifold m = narrowPhase(A, B); // At this point, it's worth running SAT 
+            if (impact < 1.0f) {
+                setPose(impact);
+                placedAt[f] = impact;
+            } else if (held) {
+                setPose(1.0f); // The re-integrated end pose
+                placedAt[f] = 1.0f;
+            } else {
+                bodies.position[i] = endPosition;
+                bodies.rotation[i] = endRotation;
+                bodies.rotorCos[i] = endCos;
+                bodies.rotorSin[i] = endSin;
+            }
+            bodies.update[i] = 1; // Transformed and bounded again by the broadphase
 
-        if (m.inCollision) {
-            manifolds.push_back(std::move(m)); // Add manifold to solver list 
         }
 
+    });
+
+    m_stats.ccdBodies += fastCount;
+    for (int f = 0; f < fastCount; ++f) {
+        if (placedAt[f] >= 0.0f) placed.push_back(CCDPlacement{ fast[f], placedAt[f] });
     }
+    m_stats.ccdHits += placed.size();
+
 }
 
-void resolveCollision(Manifold& manifold) {
+void sortManifolds(const BodyStore& bodies, FrameVector<Manifold>& manifolds) {
+
+    // Canonical manifold order for deterministic mode, by slot pair key ( unique per pair, so the order is total ).
+    // Dense indices and grid hashing may differ between runs that should match, slots do not.
+
+    auto key = [&](const Manifold& m) {
+        return partioning::pairKey(static_cast<int>(bodies.slot[m.A]), static_cast<int>(bodies.slot[m.B]));
+    };
+    std::sort(manifolds.begin(), manifolds.end(), [&](const Manifold& x, const Manifold& y) { return key(x) < key(y); });
+
+}
 
-    // Resolves collision by applying impulses at each contact point.
+void applyContactImpulse(BodyStore& bodies, const ContactConstraint& c, int k, const Vec2& impulse) {
+
+    // Static bodies are never written, one static body may be shared by constraints solved concurrently
+
+    if (!bodies.isStatic[c.A]) {
+        bodies.linearVelocity[c.A] -= impulse * bodies.inverseMass[c.A];
+        bodies.angularVelocity[c.A] -= vecMath::cross(c.rA[k], impulse) * bodies.inverseInertia[c.A];
+    }
+    if (!bodies.isStatic[c.B]) {
+        bodies.linearVelocity[c.B] += impulse * bodies.inverseMass[c.B];
+        bodies.angularVelocity[c.B] += vecMath::cross(c.rB[k], impulse) * bodies.inverseInertia[c.B];
+    }
+
+}
+
+Vec2 relativeVelocity(const BodyStore& bodies, const ContactConstraint& c, int k) {
+
+    // Velocity of B relative to A at contact k
+
+    Vec2 velocityA = bodies.linearVelocity[c.A] + vecMath::floatCross(bodies.angularVelocity[c.A], c.rA[k]);
+    Vec2 velocityB = bodies.linearVelocity[c.B] + vecMath::floatCross(bodies.angularVelocity[c.B], c.rB[k]);
+    return velocityB - velocityA;
+
+}
+
+void prepareContacts(BodyStore& bodies, const FrameVector<Manifold>& manifolds, FrameVector<ContactConstraint>& constraints,
+                     const PairCache<CachedManifold>& cache, WorldStats& m_stats) {
+
+    // Builds one ContactConstraint per manifold: contact offsets, effective masses and restitution bias.
+    // Contacts that match one cached from the previous step ( same pair, anchor within kContactMatchDistance )
+    // inherit its accumulated impulses, which are applied straight away as a warm start.
+
+    constraints.reserve(manifolds.size());
+
+    for (const Manifold& m : manifolds) {
+
+        ContactConstraint c{};
+        c.A = m.A;
+        c.B = m.B;
+        c.normal = m.normal;
+        c.tangent = Vec2(m.normal.y, -m.normal.x);
+        c.contactCount = m.contactCount;
+        c.staticFriction = std::max(bodies.staticFriction[m.A], bodies.staticFriction[m.B]);
+        c.dynamicFriction = std::max(bodies.dynamicFriction[m.A], bodies.dynamicFriction[m.B]);
+
+        const float restitution = std::min(bodies.restitution[m.A], bodies.restitution[m.B]);
+        const float inverseMassSum = bodies.inverseMass[m.A] + bodies.inverseMass[m.B];
+        const float inverseInertiaA = bodies.inverseInertia[m.A];
+        const float inverseInertiaB = bodies.inverseInertia[m.B];
+
+        const uint32_t slotA = bodies.slot[m.A];
+        const uint32_t slotB = bodies.slot[m.B];
+        const int anchorBody = (slotA < slotB) ? m.A : m.B; // Anchors are stored relative to the lower slot, whatever the pair order
+        const CachedManifold* cached = cache.find(partioning::pairKey(static_cast<int>(slotA), static_cast<int>(slotB)));
+
+        const Vec2 contacts[2] = { m.contact1, m.contact2 };
+
+        for (int k = 0; k < c.contactCount; ++k) {
+
+            c.rA[k] = contacts[k] - bodies.position[m.A];
+            c.rB[k] = contacts[k] - bodies.position[m.B];
+            c.anchorA[k] = physEng::toLocal(bodies, m.A, contacts[k]);
+            c.anchorB[k] = physEng::toLocal(bodies, m.B, contacts[k]);
+            c.separation[k] = -m.contactPenetration[k];
+
+            float rnA = vecMath::cross(c.rA[k], c.normal);
+            float rnB = vecMath::cross(c.rB[k], c.normal);
+            float kNormal = inverseMassSum + rnA * rnA * inverseInertiaA + rnB * rnB * inverseInertiaB;
+            c.normalMass[k] = (kNormal > 0.0f) ? 1.0f / kNormal : 0.0f;
+
+            float rtA = vecMath::cross(c.rA[k], c.tangent);
+            float rtB = vecMath::cross(c.rB[k], c.tangent);
+            float kTangent = inverseMassSum + rtA * rtA * inverseInertiaA + rtB * rtB * inverseInertiaB;
+            c.tangentMass[k] = (kTangent > 0.0f) ? 1.0f / kTangent : 0.0f;
+
+            float approach = vecMath::dot(relativeVelocity(bodies, c, k), c.normal);
+            c.velocityBias[k] = (approach < -kRestitutionThreshold) ? -restitution * approach : 0.0f;
+
+            if (!cached) continue;
+
+            const Vec2& anchor = (anchorBody == m.A) ? c.anchorA[k] : c.anchorB[k];
+            for (int n = 0; n < cached->contactCount; ++n) {
+                const CachedContact& old = cached->contacts[n];
+                if (vecMath::distanceSquared(anchor, old.anchor) > kContactMatchDistance * kContactMatchDistance) continue;
+                c.normalImpulse[k] = old.normalImpulse;
+                c.tangentImpulse[k] = old.tangentImpulse;
+                m_stats.contactsWarmStarted++;
+                break;
+            }
+
+        }
+
+        for (int k = 0; k < c.contactCount; ++k) { // Warm start
+            applyContactImpulse(bodies, c, k, c.normal * c.normalImpulse[k] + c.tangent * c.tangentImpulse[k]);
+        }
+
+        constraints.push_back(c);
+
+    }
+
+}
+
+float resolveCollision(BodyStore& bodies, ContactConstraint& c) {
+
+    // One sequential-impulse iteration over a contact constraint.
     // Preconditions:
-    // - manifold.inCollision == true
-    // - manifold.normal is unit length and points from A -> B
+    // - c was built by prepareContacts()
+    // - c.normal is unit length and points from A -> B
     // - contactCount in [1,2]
+    // Returns the largest change made to any accumulated impulse, used by the adaptive solver to detect convergence
 
-    RigidBody& A = manifold.A;
-    RigidBody& B = manifold.B;
-    const Vec2& normal = manifold.normal;
+    float largestChange = 0.0f;
 
-    const Vec2* contacts[2];
-    int contactCount = 0;
-    if (manifold.contactCount >= 1) contacts[contactCount++] = &manifold.contact1;
-    if (manifold.contactCount >= 2) contacts[contactCount++] = &manifold.contact2;
+    for (int k = 0; k < c.contactCount; ++k) {
 
-    impulseManifold impulses[4];
-    int impulseCount = 0;
+        // Friction first, so the normal impulse has the final say on penetration.
+        // Coulomb cone: stick while within staticFriction * normal impulse, otherwise slide at dynamicFriction.
+        float vt = vecMath::dot(relativeVelocity(bodies, c, k), c.tangent);
+        float oldTangent = c.tangentImpulse[k];
+        float newTangent = oldTangent - c.tangentMass[k] * vt;
 
-    float staticFriction = std::max(A.staticFriction, B.staticFriction);
-    float dynamicFriction = std::max(A.dynamicFriction, B.dynamicFriction);
+        float staticLimit = c.staticFriction * c.normalImpulse[k];
+        if (std::abs(newTangent) > staticLimit) {
+            float dynamicLimit = c.dynamicFriction * c.normalImpulse[k];
+            newTangent = std::max(-dynamicLimit, std::min(newTangent, dynamicLimit));
+        }
 
-    for (int idx = 0; idx < contactCount; ++idx) {
-        
-        // Goes through each vertex contact point in a manifold,
-        // and applies an impulse resolution
+        c.tangentImpulse[k] = newTangent;
+        applyContactImpulse(bodies, c, k, c.tangent * (newTangent - oldTangent));
+        largestChange = std::max(largestChange, std::abs(newTangent - oldTangent));
 
-        const Vec2& contact = *contacts[idx];
+    }
 
-        Vec2 radiusA = contact - A.position;
-        Vec2 radiusB = contact - B.position;
+    for (int k = 0; k < c.contactCount; ++k) {
 
-        // Perpendicular radii
-        Vec2 rA(-radiusA.y, radiusA.x);
-        Vec2 rB(-radiusB.y, radiusB.x);
+        // Normal impulse, the accumulated total may only push bodies apart
+        float vn = vecMath::dot(relativeVelocity(bodies, c, k), c.normal);
+        float oldNormal = c.normalImpulse[k];
+        float newNormal = std::max(oldNormal + c.normalMass[k] * (c.velocityBias[k] - vn), 0.0f);
 
-        Vec2 AtangentialVelocity = rA * A.angularVelocity;
-        Vec2 BtangentialVelocity = rB * B.angularVelocity;
+        c.normalImpulse[k] = newNormal;
+        applyContactImpulse(bodies, c, k, c.normal * (newNormal - oldNormal));
+        largestChange = std::max(largestChange, std::abs(newNormal - oldNormal));
 
-        Vec2 relativeVel =
-            (B.linearVelocity + BtangentialVelocity) -
-            (A.linearVelocity + AtangentialVelocity);
+    }
 
-        float velAlongNormal = vecMath::dot(relativeVel, normal);
-        if (velAlongNormal > 0.0f) continue;
+    return largestChange;
 
-        Vec2 tangent = relativeVel - normal * vecMath::dot(relativeVel, normal);
+}
 
-        bool applyFriction = true;
-        if (vecMath::floatCloselyEqual(tangent.length(), 0.0f)) {
-            applyFriction = false;
-        } else {
-            tangent = tangent.normalise();
+#if defined(__SSE2__) || defined(_M_X64)
+
+float resolveCollisions4(BodyStore& bodies, ContactConstraint* c) {
+
+    // resolveCollision() on four constraints of one colour batch at once, one per SSE lane.
+    // No two of them share a dynamic body ( see colourConstraints() ), so each lane gathers its bodies' velocities,
+    // runs resolveCollision()'s operations in the same order, then scatters them back: the results are bit-identical.
+    // A lane's missing second contact and its static bodies are masked out instead of branched on.
+
+    auto gather = [](auto&& get) { return _mm_setr_ps(get(0), get(1), get(2), get(3)); };
+    auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    const int A[4] = { c[0].A, c[1].A, c[2].A, c[3].A };
+    const int B[4] = { c[0].B, c[1].B, c[2].B, c[3].B };
+    const __m128 dynamicA = _mm_castsi128_ps(_mm_setr_epi32(bodies.isStatic[A[0]] ? 0 : -1, bodies.isStatic[A[1]] ? 0 : -1,
+                                                             bodies.isStatic[A[2]] ? 0 : -1, bodies.isStatic[A[3]] ? 0 : -1));
+    const __m128 dynamicB = _mm_castsi128_ps(_mm_setr_epi32(bodies.isStatic[B[0]] ? 0 : -1, bodies.isStatic[B[1]] ? 0 : -1,
+                                                             bodies.isStatic[B[2]] ? 0 : -1, bodies.isStatic[B[3]] ? 0 : -1));
+
+    __m128 velocityAx = gather([&](int l) { return bodies.linearVelocity[A[l]].x; });
+    __m128 velocityAy = gather([&](int l) { return bodies.linearVelocity[A[l]].y; });
+    __m128 spinA = gather([&](int l) { return bodies.angularVelocity[A[l]]; });
+    __m128 velocityBx = gather([&](int l) { return bodies.linearVelocity[B[l]].x; });
+    __m128 velocityBy = gather([&](int l) { return bodies.linearVelocity[B[l]].y; });
+    __m128 spinB = gather([&](int l) { return bodies.angularVelocity[B[l]]; });
+    const __m128 inverseMassA = gather([&](int l) { return bodies.inverseMass[A[l]]; });
+    const __m128 inverseInertiaA = gather([&](int l) { return bodies.inverseInertia[A[l]]; });
+    const __m128 inverseMassB = gather([&](int l) { return bodies.inverseMass[B[l]]; });
+    const __m128 inverseInertiaB = gather([&](int l) { return bodies.inverseInertia[B[l]]; });
+
+    const __m128 normalX = gather([&](int l) { return c[l].normal.x; });
+    const __m128 normalY = gather([&](int l) { return c[l].normal.y; });
+    const __m128 tangentX = gather([&](int l) { return c[l].tangent.x; });
+    const __m128 tangentY = gather([&](int l) { return c[l].tangent.y; });
+    const __m128 staticFriction = gather([&](int l) { return c[l].staticFriction; });
+    const __m128 dynamicFriction = gather([&](int l) { return c[l].dynamicFriction; });
+
+    __m128 largestChange = zero;
+
+    // -- Lever arms, then one impulse of direction (dx, dy) and size delta per lane, as relativeVelocity() and
+    // applyContactImpulse() do it
+
+    __m128 rAx, rAy, rBx, rBy, active, applyA, applyB;
+    auto loadContact = [&](int k) {
+        auto field = [&](auto&& get) { return gather([&](int l) { return (k < c[l].contactCount) ? get(c[l]) : 0.0f; }); };
+        rAx = field([&](const ContactConstraint& x) { return x.rA[k].x; });
+        rAy = field([&](const ContactConstraint& x) { return x.rA[k].y; });
+        rBx = field([&](const ContactConstraint& x) { return x.rB[k].x; });
+        rBy = field([&](const ContactConstraint& x) { return x.rB[k].y; });
+        active = _mm_castsi128_ps(_mm_setr_epi32(k < c[0].contactCount ? -1 : 0, k < c[1].contactCount ? -1 : 0,
+                                                 k < c[2].contactCount ? -1 : 0, k < c[3].contactCount ? -1 : 0));
+        applyA = _mm_and_ps(active, dynamicA);
+        applyB = _mm_and_ps(active, dynamicB);
+    };
+    auto along = [&](__m128 dx, __m128 dy) { // Relative velocity at the contact, along (dx, dy)
+        const __m128 vAx = _mm_sub_ps(velocityAx, _mm_mul_ps(spinA, rAy));
+        const __m128 vAy = _mm_add_ps(velocityAy, _mm_mul_ps(spinA, rAx));
+        const __m128 vBx = _mm_sub_ps(velocityBx, _mm_mul_ps(spinB, rBy));
+        const __m128 vBy = _mm_add_ps(velocityBy, _mm_mul_ps(spinB, rBx));
+        return _mm_add_ps(_mm_mul_ps(_mm_sub_ps(vBx, vAx), dx), _mm_mul_ps(_mm_sub_ps(vBy, vAy), dy));
+    };
+    auto apply = [&](__m128 dx, __m128 dy, __m128 delta) {
+        const __m128 px = _mm_mul_ps(dx, delta);
+        const __m128 py = _mm_mul_ps(dy, delta);
+        velocityAx = select(applyA, _mm_sub_ps(velocityAx, _mm_mul_ps(px, inverseMassA)), velocityAx);
+        velocityAy = select(applyA, _mm_sub_ps(velocityAy, _mm_mul_ps(py, inverseMassA)), velocityAy);
+        spinA = select(applyA, _mm_sub_ps(spinA, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(rAx, py), _mm_mul_ps(rAy, px)), inverseInertiaA)), spinA);
+        velocityBx = select(applyB, _mm_add_ps(velocityBx, _mm_mul_ps(px, inverseMassB)), velocityBx);
+        velocityBy = select(applyB, _mm_add_ps(velocityBy, _mm_mul_ps(py, inverseMassB)), velocityBy);
+        spinB = select(applyB, _mm_add_ps(spinB, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(rBx, py), _mm_mul_ps(rBy, px)), inverseInertiaB)), spinB);
+        largestChange = _mm_max_ps(_mm_andnot_ps(signBit, delta), largestChange);
+    };
+    auto store = [&](__m128 impulse, float (ContactConstraint::*accumulated)[2], int k) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, impulse);
+        for (int l = 0; l < 4; ++l) {
+            if (k < c[l].contactCount) (c[l].*accumulated)[k] = lanes[l];
         }
+    };
 
-        float rADot = vecMath::dot(rA, normal);
-        float rBDot = vecMath::dot(rB, normal);
-        float minRestitution = std::min(A.restitution, B.restitution);
+    for (int k = 0; k < 2; ++k) { // Friction, within the Coulomb cone
 
-        float denominator =
-            A.inverseMass + B.inverseMass +
-            (rADot * rADot) * A.inverseInertia +
-            (rBDot * rBDot) * B.inverseInertia;
+        loadContact(k);
+        auto field = [&](auto&& get) { return gather([&](int l) { return (k < c[l].contactCount) ? get(c[l]) : 0.0f; }); };
+        const __m128 tangentMass = field([&](const ContactConstraint& x) { return x.tangentMass[k]; });
+        const __m128 normalImpulse = field([&](const ContactConstraint& x) { return x.normalImpulse[k]; });
+        const __m128 oldTangent = field([&](const ContactConstraint& x) { return x.tangentImpulse[k]; });
 
-        if (vecMath::floatCloselyEqual(denominator, 0.0f)) continue;
+        __m128 newTangent = _mm_sub_ps(oldTangent, _mm_mul_ps(tangentMass, along(tangentX, tangentY)));
+        const __m128 outside = _mm_cmpgt_ps(_mm_andnot_ps(signBit, newTangent), _mm_mul_ps(staticFriction, normalImpulse));
+        const __m128 dynamicLimit = _mm_mul_ps(dynamicFriction, normalImpulse);
+        const __m128 clamped = _mm_max_ps(_mm_min_ps(dynamicLimit, newTangent), _mm_xor_ps(dynamicLimit, signBit));
+        newTangent = select(_mm_and_ps(active, outside), clamped, newTangent);
+        newTangent = select(active, newTangent, oldTangent);
 
-        float j = -(1.0f + minRestitution) * velAlongNormal;
-        j /= denominator;
-        j /= static_cast<float>(manifold.contactCount);
+        apply(tangentX, tangentY, _mm_sub_ps(newTangent, oldTangent));
+        store(newTangent, &ContactConstraint::tangentImpulse, k);
 
-        Vec2 impulse = normal * j;
-        impulses[impulseCount++] = { impulse, radiusA, radiusB };
+    }
 
-        if (applyFriction) {
+    for (int k = 0; k < 2; ++k) { // Normal, the accumulated total may only push bodies apart
 
-            float rADotTangential = vecMath::dot(rA, tangent);
-            float rBDotTangential = vecMath::dot(rB, tangent);
+        loadContact(k);
+        auto field = [&](auto&& get) { return gather([&](int l) { return (k < c[l].contactCount) ? get(c[l]) : 0.0f; }); };
+        const __m128 normalMass = field([&](const ContactConstraint& x) { return x.normalMass[k]; });
+        const __m128 velocityBias = field([&](const ContactConstraint& x) { return x.velocityBias[k]; });
+        const __m128 oldNormal = field([&](const ContactConstraint& x) { return x.normalImpulse[k]; });
 
-            float denominatorTangential =
-                A.inverseMass + B.inverseMass +
-                (rADotTangential * rADotTangential) * A.inverseInertia +
-                (rBDotTangential * rBDotTangential) * B.inverseInertia;
+        __m128 newNormal = _mm_add_ps(oldNormal, _mm_mul_ps(normalMass, _mm_sub_ps(velocityBias, along(normalX, normalY))));
+        newNormal = select(active, _mm_max_ps(zero, newNormal), oldNormal);
 
-            if (!vecMath::floatCloselyEqual(denominatorTangential, 0.0f)) {
-                float jTangent = -vecMath::dot(relativeVel, tangent);
-                jTangent /= denominatorTangential;
-                jTangent /= static_cast<float>(manifold.contactCount);
+        apply(normalX, normalY, _mm_sub_ps(newNormal, oldNormal));
+        store(newNormal, &ContactConstraint::normalImpulse, k);
 
-                Vec2 frictionImpulse;
-                if (std::abs(jTangent) <= j * staticFriction) {
-                    frictionImpulse = tangent * jTangent;
-                } else {
-                    frictionImpulse = tangent * (-j * dynamicFriction);
-                }
+    }
 
-                impulses[impulseCount++] = { frictionImpulse, radiusA, radiusB };
+    alignas(16) float lanes[6][4];
+    _mm_store_ps(lanes[0], velocityAx);
+    _mm_store_ps(lanes[1], velocityAy);
+    _mm_store_ps(lanes[2], spinA);
+    _mm_store_ps(lanes[3], velocityBx);
+    _mm_store_ps(lanes[4], velocityBy);
+    _mm_store_ps(lanes[5], spinB);
+    for (int l = 0; l < 4; ++l) { // Static bodies are never written, one may be shared by all four lanes
+        if (!bodies.isStatic[A[l]]) {
+            bodies.linearVelocity[A[l]] = Vec2(lanes[0][l], lanes[1][l]);
+            bodies.angularVelocity[A[l]] = lanes[2][l];
+        }
+        if (!bodies.isStatic[B[l]]) {
+            bodies.linearVelocity[B[l]] = Vec2(lanes[3][l], lanes[4][l]);
+            bodies.angularVelocity[B[l]] = lanes[5][l];
+        }
+    }
+
+    largestChange = _mm_max_ps(largestChange, _mm_movehl_ps(largestChange, largestChange));
+    largestChange = _mm_max_ss(largestChange, _mm_shuffle_ps(largestChange, largestChange, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(largestChange);
+
+}
+
+#else
+
+float resolveCollisions4(BodyStore& bodies, ContactConstraint* c) {
+
+    // resolveCollision() on four constraints of one colour batch, scalar fallback
+
+    float largestChange = 0.0f;
+    for (int l = 0; l < 4; ++l) largestChange = std::max(largestChange, resolveCollision(bodies, c[l]));
+    return largestChange;
+
+}
+
+#endif
+
+const int kMaxColours = 64; // One bit per colour in a body's mask, constraints that find no free colour go to an extra serial batch
+const int kSolverGrain = 128; // Constraints per job chunk, a multiple of the four resolveCollisions4() solves at once
+
+void colourConstraints(const BodyStore& bodies, FrameVector<ContactConstraint>& constraints, FrameVector<int>& colourStarts, FrameArena& arena) {
+
+    // Greedy graph colouring: each constraint takes the lowest colour not yet used by either of its dynamic bodies.
+    // Constraints are then regrouped so each colour is one contiguous batch, in which no two constraints share a
+    // dynamic body. A batch can therefore be solved in any order, on any number of threads ( or SIMD lanes ),
+    // with the same result. Within a batch the original order is kept.
+    // Static bodies are only read while solving, so they never constrain the colouring.
+    // Effects: reorders constraints, colourStarts[c]..colourStarts[c + 1] is batch c ( the last batch is the
+    // serial overflow batch, usually empty ).
+
+    FrameVector<uint64_t> usedColours(bodies.size(), 0, ArenaAllocator<uint64_t>(arena));
+    FrameVector<uint8_t> colourOf(constraints.size(), 0, ArenaAllocator<uint8_t>(arena));
+    colourStarts.assign(kMaxColours + 2, 0);
+
+    for (size_t i = 0; i < constraints.size(); ++i) {
+
+        const ContactConstraint& c = constraints[i];
+        const bool dynamicA = !bodies.isStatic[c.A];
+        const bool dynamicB = !bodies.isStatic[c.B];
+
+        uint64_t used = (dynamicA ? usedColours[c.A] : 0) | (dynamicB ? usedColours[c.B] : 0);
+        int colour = kMaxColours;
+        if (~used != 0) {
+            colour = 0;
+            while (used & (uint64_t(1) << colour)) colour++;
+            if (dynamicA) usedColours[c.A] |= uint64_t(1) << colour;
+            if (dynamicB) usedColours[c.B] |= uint64_t(1) << colour;
+        }
+
+        colourOf[i] = static_cast<uint8_t>(colour);
+        colourStarts[colour + 1]++;
+
+    }
+
+    for (int colour = 0; colour <= kMaxColours; ++colour) colourStarts[colour + 1] += colourStarts[colour];
+
+    FrameVector<int> cursor(colourStarts.begin(), colourStarts.end() - 1, ArenaAllocator<int>(arena));
+    FrameVector<ContactConstraint> sorted(constraints.size(), ArenaAllocator<ContactConstraint>(arena));
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        sorted[cursor[colourOf[i]]++] = constraints[i];
+    }
+    constraints.swap(sorted);
+
+}
+
+template<typename Solve, typename SolveFour>
+float solveColours(FrameVector<ContactConstraint>& constraints, const FrameVector<int>& colourStarts, JobSystem& jobs,
+                   FrameVector<float>& chunkChange, Solve&& solve, SolveFour&& solveFour) {
+
+    // One sweep over every constraint, batch by batch ( see colourConstraints() ). Batches are spread over jobs,
+    // the overflow batch runs serially. solve(c) returns the largest impulse change it made to c, solveFour(c) the
+    // largest it made to c[0..3], four constraints of one batch. Each chunk hands solveFour() its constraints four at
+    // a time from the chunk's start, kSolverGrain being a multiple of four, so the grouping does not depend on jobs.
+    // Returns the largest change of the sweep, reduced per chunk so it does not depend on scheduling.
+
+    float largestChange = 0.0f;
+
+    for (int colour = 0; colour <= kMaxColours; ++colour) {
+
+        ContactConstraint* batch = constraints.data() + colourStarts[colour];
+        const int batchSize = colourStarts[colour + 1] - colourStarts[colour];
+        if (batchSize == 0) continue;
+
+        if (colour == kMaxColours) { // Overflow batch, its constraints may share bodies
+            for (int i = 0; i < batchSize; ++i) {
+                largestChange = std::max(largestChange, solve(batch[i]));
+            }
+            continue;
+        }
+
+        jobs.parallelFor(batchSize, kSolverGrain, [&](int begin, int end) {
+            float change = 0.0f;
+            int i = begin;
+            for (; i + 4 <= end; i += 4) {
+                change = std::max(change, solveFour(batch + i));
+            }
+            for (; i < end; ++i) {
+                change = std::max(change, solve(batch[i]));
             }
+            chunkChange[begin / kSolverGrain] = change;
+        });
+
+        const int chunks = (batchSize + kSolverGrain - 1) / kSolverGrain;
+        for (int chunk = 0; chunk < chunks; ++chunk) largestChange = std::max(largestChange, chunkChange[chunk]);
+
+    }
+
+    return largestChange;
+
+}
 
+template<typename Solve>
+float solveColours(FrameVector<ContactConstraint>& constraints, const FrameVector<int>& colourStarts, JobSystem& jobs,
+                   FrameVector<float>& chunkChange, Solve&& solve) {
+
+    // solveColours() for solvers without a four-wide form, each constraint is solved on its own
+
+    return solveColours(constraints, colourStarts, jobs, chunkChange, solve, [&](ContactConstraint* c) {
+        float change = 0.0f;
+        for (int l = 0; l < 4; ++l) change = std::max(change, solve(c[l]));
+        return change;
+    });
+
+}
+
+struct Softness {
+
+    // Soft constraint coefficients of a damped spring, for one substep ( see makeSoftness() )
+
+    float biasRate; // Fraction of the overlap pushed out per second
+    float massScale; // Scales the effective mass, so the constraint only partially corrects each substep
+    float impulseScale; // Fraction of the accumulated impulse relaxed away each substep
+
+};
+
+Softness makeSoftness(float hertz, float dampingRatio, float h) {
+
+    // Implicit damped spring of frequency hertz and damping ratio, integrated over a substep of h seconds.
+    // A rigid constraint ( hertz of 0 ) has no bias and full mass.
+
+    if (hertz <= 0.0f) return Softness{ 0.0f, 1.0f, 0.0f };
+
+    const float omega = 2.0f * vecMath::pi * hertz;
+    const float a1 = 2.0f * dampingRatio + h * omega;
+    const float a2 = h * omega * a1;
+    const float a3 = 1.0f / (1.0f + a2);
+    return Softness{ omega / a1, a2 * a3, a3 };
+
+}
+
+void resolveSoftContact(BodyStore& bodies, ContactConstraint& c, const Softness& soft, float inverseH, float maxPushVelocity, bool useBias) {
+
+    // One soft-constraint pass over a contact, run twice per substep ( solve with useBias, then relax without ).
+    // The separation is tracked from the bodies' current poses and the anchors fixed at detection:
+    // - Apart, only the approach that would close more than the gap within this substep is removed ( speculative )
+    // - Overlapping, the solve pass pushes the overlap out softly, no faster than maxPushVelocity, and the relax
+    //   pass only removes approach, so the push-out does not leave the bodies moving apart
+    // Lever arms stay those at detection, as in resolveCollision(), whose friction this shares.
+
+    for (int k = 0; k < c.contactCount; ++k) {
+
+        float vt = vecMath::dot(relativeVelocity(bodies, c, k), c.tangent);
+        float oldTangent = c.tangentImpulse[k];
+        float newTangent = oldTangent - c.tangentMass[k] * vt;
+
+        float staticLimit = c.staticFriction * c.normalImpulse[k];
+        if (std::abs(newTangent) > staticLimit) {
+            float dynamicLimit = c.dynamicFriction * c.normalImpulse[k];
+            newTangent = std::max(-dynamicLimit, std::min(newTangent, dynamicLimit));
+        }
+
+        c.tangentImpulse[k] = newTangent;
+        applyContactImpulse(bodies, c, k, c.tangent * (newTangent - oldTangent));
+
+    }
+
+    auto offset = [&](int body, const Vec2& anchor) { // Anchor rotated by the body's current rotor
+        const float cs = bodies.rotorCos[body];
+        const float sn = bodies.rotorSin[body];
+        return Vec2(anchor.x * cs - anchor.y * sn, anchor.x * sn + anchor.y * cs);
+    };
+
+    for (int k = 0; k < c.contactCount; ++k) {
+
+        const Vec2 d = (bodies.position[c.B] + offset(c.B, c.anchorB[k])) - (bodies.position[c.A] + offset(c.A, c.anchorA[k]));
+        const float separation = vecMath::dot(d, c.normal) + c.separation[k];
+
+        float bias = 0.0f;
+        float massScale = 1.0f;
+        float impulseScale = 0.0f;
+        if (separation > 0.0f) {
+            bias = separation * inverseH;
+        } else if (useBias) {
+            bias = std::max(soft.biasRate * separation, -maxPushVelocity);
+            massScale = soft.massScale;
+            impulseScale = soft.impulseScale;
+        }
+
+        float vn = vecMath::dot(relativeVelocity(bodies, c, k), c.normal);
+        float oldNormal = c.normalImpulse[k];
+        float newNormal = std::max(oldNormal - c.normalMass[k] * massScale * (vn + bias) - impulseScale * oldNormal, 0.0f);
+
+        c.normalImpulse[k] = newNormal;
+        applyContactImpulse(bodies, c, k, c.normal * (newNormal - oldNormal));
+
+    }
+
+}
+
+void applyRestitution(BodyStore& bodies, ContactConstraint& c) {
+
+    // Run once after the substeps: contacts that were approaching faster than kRestitutionThreshold, and that
+    // did push, are given their bounce ( velocityBias ). Soft contacts would otherwise absorb it.
+
+    for (int k = 0; k < c.contactCount; ++k) {
+
+        if (c.velocityBias[k] == 0.0f || c.normalImpulse[k] == 0.0f) continue;
+
+        float vn = vecMath::dot(relativeVelocity(bodies, c, k), c.normal);
+        float oldNormal = c.normalImpulse[k];
+        float newNormal = std::max(oldNormal + c.normalMass[k] * (c.velocityBias[k] - vn), 0.0f);
+
+        c.normalImpulse[k] = newNormal;
+        applyContactImpulse(bodies, c, k, c.normal * (newNormal - oldNormal));
+
+    }
+
+}
+
+int solveSubsteps(BodyStore& bodies, FrameVector<ContactConstraint>& constraints, const FrameVector<int>& colourStarts,
+                  const FrameVector<StartPose>& startPoses, const SolverSettings& settings, const Vec2& gravity, float dt,
+                  JobSystem& jobs, FrameVector<float>& chunkChange) {
+
+    // SolverMode::Substeps ( see SolverSettings ). Contacts were detected, and warm started, at the integrated pose.
+    // - Moved bodies are rewound to their start pose, contacts keep their anchors in each body's frame. A body CCD
+    //   placed starts where it was placed, and only moves through the part of the step left after it
+    // - Each substep integrates velocities, warm starts ( the first substep was by prepareContacts() ), solves every
+    //   contact once with bias, integrates positions, then relaxes every contact once without bias
+    // - Restitution is applied once at the end, and the rotors integrated through the substeps are replaced by
+    //   the exact ones of the final rotation
+    // Accumulated impulses are per substep, so warm starting every substep reapplies the previous substep's push.
+    // Returns the substeps run.
+
+    const int substeps = std::max(settings.substeps, 1);
+    const float h = dt / substeps;
+    const float inverseH = 1.0f / h;
+    const Softness soft = makeSoftness(std::min(settings.contactHertz, 0.25f * inverseH), settings.dampingRatio, h);
+    const int count = bodies.size();
+
+    for (int i = 0; i < count; ++i) {
+        if (bodies.isStatic[i] || !bodies.awake[i]) continue;
+        const StartPose& start = startPoses[bodies.slot[i]];
+        if (!start.moved) continue;
+        bodies.position[i] = start.position;
+        bodies.rotation[i] = start.rotation;
+        bodies.rotorCos[i] = start.rotorCos;
+        bodies.rotorSin[i] = start.rotorSin;
+    }
+
+    auto warmStart = [&](ContactConstraint& c) {
+        for (int k = 0; k < c.contactCount; ++k) {
+            applyContactImpulse(bodies, c, k, c.normal * c.normalImpulse[k] + c.tangent * c.tangentImpulse[k]);
         }
+        return 0.0f;
+    };
+    auto solve = [&](ContactConstraint& c) { resolveSoftContact(bodies, c, soft, inverseH, settings.maxPushVelocity, true); return 0.0f; };
+    auto relax = [&](ContactConstraint& c) { resolveSoftContact(bodies, c, soft, inverseH, settings.maxPushVelocity, false); return 0.0f; };
+
+    for (int step = 0; step < substeps; ++step) {
+
+        for (int i = 0; i < count; ++i) {
+            if (bodies.isStatic[i] || !bodies.awake[i]) continue;
+            bodies.linearVelocity[i] += gravity * (h * (1.0f - startPoses[bodies.slot[i]].skipped));
+        }
+
+        if (step > 0) solveColours(constraints, colourStarts, jobs, chunkChange, warmStart);
+        solveColours(constraints, colourStarts, jobs, chunkChange, solve);
+
+        for (int i = 0; i < count; ++i) {
+            if (bodies.isStatic[i] || !bodies.awake[i]) continue;
+            const float bodyH = h * (1.0f - startPoses[bodies.slot[i]].skipped);
+            const float turn = bodies.angularVelocity[i] * bodyH;
+            const float cs = bodies.rotorCos[i] - turn * bodies.rotorSin[i]; // Rotor advanced by turn, then renormalised
+            const float sn = bodies.rotorSin[i] + turn * bodies.rotorCos[i];
+            const float inverseLength = 1.0f / std::sqrt(cs * cs + sn * sn);
+            bodies.position[i] += bodies.linearVelocity[i] * bodyH;
+            bodies.rotation[i] += turn;
+            bodies.rotorCos[i] = cs * inverseLength;
+            bodies.rotorSin[i] = sn * inverseLength;
+        }
+
+        solveColours(constraints, colourStarts, jobs, chunkChange, relax);
 
     }
 
-    for (int i = 0; i < impulseCount; ++i) {
+    solveColours(constraints, colourStarts, jobs, chunkChange, [&](ContactConstraint& c) { applyRestitution(bodies, c); return 0.0f; });
+
+    for (int i = 0; i < count; ++i) {
+        if (bodies.isStatic[i] || !bodies.awake[i]) continue;
+        bodies.rotorCos[i] = std::cos(bodies.rotation[i]);
+        bodies.rotorSin[i] = std::sin(bodies.rotation[i]);
+        bodies.update[i] = 1; // Moved since the broadphase transformed it
+    }
+
+    return substeps;
+
+}
+
+void storeContacts(const BodyStore& bodies, const FrameVector<ContactConstraint>& constraints, PairCache<CachedManifold>& cache) {
 
-        // Impulse calculations
+    // Saves each pair's accumulated impulses for next step's warm start
 
-        const impulseManifold& impulseData = impulses[i];
+    for (const ContactConstraint& c : constraints) {
 
-        A.linearVelocity -= impulseData.impulse * A.inverseMass;
-        B.linearVelocity += impulseData.impulse * B.inverseMass;
-        A.angularVelocity += -vecMath::cross(impulseData.rA, impulseData.impulse) * A.inverseInertia;
-        B.angularVelocity += vecMath::cross(impulseData.rB, impulseData.impulse) * B.inverseInertia;
+        const uint32_t slotA = bodies.slot[c.A];
+        const uint32_t slotB = bodies.slot[c.B];
+        const Vec2* anchors = (slotA < slotB) ? c.anchorA : c.anchorB; // Taken at detection, before the solver moved anything
+
+        CachedManifold cached;
+        cached.contactCount = c.contactCount;
+        for (int k = 0; k < c.contactCount; ++k) {
+            cached.contacts[k].anchor = anchors[k];
+            cached.contacts[k].normalImpulse = c.normalImpulse[k];
+            cached.contacts[k].tangentImpulse = c.tangentImpulse[k];
+        }
+
+        cache.store(partioning::pairKey(static_cast<int>(slotA), static_cast<int>(slotB)), cached);
 
     }
 
+    cache.flip();
+
 }
 
-void positionalCorrection(Manifold& m) {
+void positionalCorrection(BodyStore& bodies, Manifold& m) {
 
     // Corrects penetration after impulse solving
 
-    RigidBody& A = m.A;
-    RigidBody& B = m.B;
+    const int A = m.A;
+    const int B = m.B;
 
     const float percent = 0.8f;
     const float slop = 0.01f; // Intentionally allow for some overlapping to reduce jitter 
 
-    float invMassSum = A.inverseMass + B.inverseMass;
+    float invMassSum = bodies.inverseMass[A] + bodies.inverseMass[B];
     if (invMassSum <= 0.0f) return;
 
     float corrMag = std::max(m.penetration - slop, 0.0f) / invMassSum * percent;
     Vec2 correction = m.normal * corrMag;
 
-    if (!A.isStatic) {
-        A.position -= correction * A.inverseMass;
-        A.update = true;
+    if (!bodies.isStatic[A]) {
+        bodies.position[A] -= correction * bodies.inverseMass[A];
+        bodies.update[A] = 1;
     }
 
-    if (!B.isStatic) {
-        B.position += correction * B.inverseMass;
-        B.update = true;
+    if (!bodies.isStatic[B]) {
+        bodies.position[B] += correction * bodies.inverseMass[B];
+        bodies.update[B] = 1;
     }
 
 }
@@ -214,53 +1205,399 @@ void World::step(float dt) {
 
     // Advances the simulation by dt seconds
     // The current order of things:
-    // - Integrate
+    // - Integrate awake bodies
     // - Cull dead/out-of-bounds bodies
-    // - Detect collisions once
-    // - Solve impulses solverIterations times
+    // - Move fast bodies back to their time of impact with static geometry ( see continuousCollision() )
+    // - Detect collisions once, waking sleeping islands that awake bodies touch
+    // - Warm start contacts from the previous step's impulses, colour them into independent batches,
+    //   then solve the batches in parallel ( see SolverSettings )
     // - Apply positional correction once
+    //   ( SolverMode::Substeps instead rewinds moved bodies and substeps the solve and the motion, see solveSubsteps() )
+    // - Build islands and put the ones that have come to rest to sleep
+    // Transient memory comes from m_frameArena, which is released in one go at the start of each step
+
+    const uint64_t heapAllocationsBefore = memory::heapAllocationCount();
+    m_frameArena.reset();
 
-    for (auto& body : m_bodies) {
-        if (!body.isStatic) {
-            body.linearAcceleration = gravity;
-            body.linearVelocity += body.linearAcceleration * dt;
-            body.position += body.linearVelocity * dt;
-            body.rotation += body.angularVelocity * dt;
-            body.force = Vec2(0, 0);
-            body.update = true;
+    if (static_cast<int>(m_workerArenas.size()) != m_jobs->workerCount()) { // Worker count changed
+        m_workerArenas.clear();
+        for (int t = 0; t < m_jobs->workerCount(); ++t) m_workerArenas.emplace_back(kWorkerArenaBytes);
+    }
+    for (FrameArena& workerArena : m_workerArenas) workerArena.reset();
+
+    const int count = m_bodies.size();
+    const bool substepping = m_solver.mode == SolverMode::Substeps;
+
+    FrameVector<StartPose> startPoses{ArenaAllocator<StartPose>(m_frameArena)}; // By slot, substeps mode only
+    if (substepping) startPoses.resize(m_bodies.slotCount());
+
+    // Each array is walked linearly, so integration only streams the fields it touches
+    Vec2* position = m_bodies.position.data();
+    Vec2* linearVelocity = m_bodies.linearVelocity.data();
+    float* rotation = m_bodies.rotation.data();
+    float* rotorCos = m_bodies.rotorCos.data();
+    float* rotorSin = m_bodies.rotorSin.data();
+    const float* angularVelocity = m_bodies.angularVelocity.data();
+    const uint8_t* isStatic = m_bodies.isStatic.data();
+    const uint8_t* awake = m_bodies.awake.data();
+    uint8_t* update = m_bodies.update.data();
+
+    for (int i = 0; i < count; ++i) {
+        if (!isStatic[i] && awake[i]) {
+            if (substepping) startPoses[m_bodies.slot[i]] = StartPose{ position[i], linearVelocity[i], rotation[i], rotorCos[i], rotorSin[i], 1, 0.0f };
+            linearVelocity[i] += gravity * dt;
+            position[i] += linearVelocity[i] * dt;
+            rotation[i] += angularVelocity[i] * dt;
+            rotorCos[i] = std::cos(rotation[i]); // The only trig a body needs this step
+            rotorSin[i] = std::sin(rotation[i]);
+            update[i] = 1;
             m_stats.bodyUpdates++;
         }
     }
 
-    m_bodies.erase(
-        std::remove_if(
-            m_bodies.begin(),
-            m_bodies.end(),
-            [&](const RigidBody& body) {
-                return body.position.y < -m_yBounds;
-            }),
-        m_bodies.end()
-    );
+    // Culled bodies are swap-removed, so the rest of the store is never shifted or compacted
+    m_bodies.removeIf([&](int i) {
+        if (m_bodies.position[i].y >= -m_yBounds) return false;
+        if (m_bodies.isStatic[i]) m_staticGridDirty = true;
+        m_freedSlots.push_back(m_bodies.slot[i]);
+        return true;
+    });
+    if (!m_freedSlots.empty()) evictFreedSlots();
+
+    const float cellSize = persistentCellSize(); // Re-bucket the persistent grids once the broadphase retunes
+    if (!m_staticGrid.empty() && m_staticGrid.grid.baseCellSize != cellSize) m_staticGridDirty = true;
+    if (!m_sleepingGrid.empty() && m_sleepingGrid.grid.baseCellSize != cellSize) m_sleepingGridDirty = true;
+
+    if (m_staticGridDirty) rebuildStaticGrid();
+    if (m_sleepingGridDirty) rebuildSleepingGrid();
+
+    FrameVector<CCDPlacement> ccdPlaced{ArenaAllocator<CCDPlacement>(m_frameArena)};
+    if (m_continuousCollision) continuousCollision(m_bodies, m_staticGrid, dt, m_frameArena, *m_jobs, m_workerArenas, ccdPlaced, m_stats);
+
+    if (substepping) { // Bodies placed by CCD are substepped from there, through what is left of the step
+        for (const CCDPlacement& p : ccdPlaced) {
+            const int i = p.body;
+            startPoses[m_bodies.slot[i]] = StartPose{ m_bodies.position[i], m_bodies.linearVelocity[i] - gravity * (dt * (1.0f - p.time)),
+                                                      m_bodies.rotation[i], m_bodies.rotorCos[i], m_bodies.rotorSin[i], 1, p.time };
+        }
+    }
 
-    std::vector<Manifold> manifolds;
+    FrameVector<Manifold> manifolds{ArenaAllocator<Manifold>(m_frameArena)};
     manifolds.reserve(m_bodies.size());
+    FrameVector<int> touchedSleepers{ArenaAllocator<int>(m_frameArena)};
 
-    broadPhase(m_bodies, manifolds, m_stats); // The broadphase will run the narrowphase on 
+    const float margin = substepping ? m_solver.speculativeDistance : 0.0f; // Only the soft solver handles speculative contacts
+    broadPhase(m_bodies, *m_broadphase, m_staticGrid, m_sleepingGrid, dt, m_lazyTransforms, margin, manifolds, touchedSleepers, m_frameArena, *m_jobs,
+               m_workerArenas, m_axisCache, m_deterministic, m_stats); // The broadphase will run the narrowphase on 
     // good candidates, which will add to the manifolds list if in collision
+    m_axisCache.flip(); // Pairs not found apart this step lose their axis
+    m_broadphase->reportStats(m_stats);
+
+    if (m_deterministic) sortManifolds(m_bodies, manifolds);
+
+    for (int i : touchedSleepers) {
+        wakeIsland(i); // Woken before solving, so the whole island reacts to the contact this step
+    }
 
-    for (int i = 0; i < solverIterations; ++i) {
-        for (auto& manifold : manifolds) { 
-            // For each manifold collected (Which is in collision proven by SAT), 
-            // calculate impulses 
-            resolveCollision(manifold);
+    if (substepping) { // Gravity is applied per substep instead, from the start velocity
+        for (int i = 0; i < m_bodies.size(); ++i) {
+            if (m_bodies.isStatic[i] || !m_bodies.awake[i]) continue;
+            const StartPose& start = startPoses[m_bodies.slot[i]];
+            if (start.moved) m_bodies.linearVelocity[i] = start.linearVelocity;
         }
     }
 
+    FrameVector<ContactConstraint> constraints{ArenaAllocator<ContactConstraint>(m_frameArena)};
+    prepareContacts(m_bodies, manifolds, constraints, m_contactCache, m_stats); // Also warm starts from last step's impulses
+
+    FrameVector<int> colourStarts{ArenaAllocator<int>(m_frameArena)};
+    colourConstraints(m_bodies, constraints, colourStarts, m_frameArena);
+
+    // Largest impulse change per job chunk, reduced after each colour so the result does not depend on scheduling
+    FrameVector<float> chunkChange(constraints.size() / kSolverGrain + 1, 0.0f, ArenaAllocator<float>(m_frameArena));
+
+    int iterationsUsed = 0;
+    if (substepping) {
+
+        iterationsUsed = solveSubsteps(m_bodies, constraints, colourStarts, startPoses, m_solver, gravity, dt, *m_jobs, chunkChange);
+
+    } else {
+
+        // Fixed mode always runs m_solver.iterations sweeps. Adaptive mode stops as soon as a sweep changes no
+        // accumulated impulse by more than m_solver.tolerance, within [minIterations, maxIterations]
+        const int maxIterations = m_solver.adaptive ? m_solver.maxIterations : m_solver.iterations;
+        const int minIterations = m_solver.adaptive ? m_solver.minIterations : m_solver.iterations;
+
+        while (iterationsUsed < maxIterations && !constraints.empty()) {
+
+            // For each manifold collected (Which is in collision proven by SAT), refine its accumulated impulses,
+            // four constraints of a batch at a time
+            const float largestChange = solveColours(constraints, colourStarts, *m_jobs, chunkChange,
+                                                     [&](ContactConstraint& c) { return resolveCollision(m_bodies, c); },
+                                                     [&](ContactConstraint* c) { return resolveCollisions4(m_bodies, c); });
+
+            iterationsUsed++;
+            if (iterationsUsed >= minIterations && largestChange <= m_solver.tolerance) break;
+
+        }
+
+    }
+
+    m_stats.solverIterations = iterationsUsed;
+    m_stats.solverIterationsTotal += iterationsUsed;
+
+    storeContacts(m_bodies, constraints, m_contactCache);
+
     for (auto& manifold : manifolds) {
-        positionalCorrection(manifold); // Apply calculated impulses from before 
+        if (!substepping) positionalCorrection(m_bodies, manifold); // Apply calculated impulses from before 
         m_stats.contactsResolved++;
     }
 
+    updateSleep(dt, manifolds);
+
     m_stats.steps++;
+    m_stats.frameArenaBytes = m_frameArena.peakBytes();
+    m_stats.stepHeapAllocations = memory::heapAllocationCount() - heapAllocationsBefore;
+
+}
+
+void World::updateSleep(float dt, const FrameVector<Manifold>& manifolds) {
+
+    // Advances each awake body's sleep timer, builds islands of dynamic bodies connected by contacts
+    // ( union-find over this step's manifolds, statics do not join islands ), and puts every island whose
+    // bodies have all been slow for m_timeToSleep to sleep. A sleeping island is linked into a ring through
+    // sleepNext, so it can be woken as a whole without any extra storage.
+
+    const int count = m_bodies.size();
+    m_stats.sleepingBodies = 0;
+    m_stats.islands = 0;
 
-}
\ No newline at end of file
+    if (!m_allowSleeping) return;
+
+    const float linearSq = m_sleepLinearVelocity * m_sleepLinearVelocity;
+    const float angularSq = m_sleepAngularVelocity * m_sleepAngularVelocity;
+
+    for (int i = 0; i < count; ++i) {
+        if (m_bodies.isStatic[i] || !m_bodies.awake[i]) continue;
+        float w = m_bodies.angularVelocity[i];
+        if (m_bodies.linearVelocity[i].lengthSquared() > linearSq || w * w > angularSq) {
+            m_bodies.sleepTime[i] = 0.0f;
+        } else {
+            m_bodies.sleepTime[i] += dt;
+        }
+    }
+
+    FrameVector<int> parent(count, 0, ArenaAllocator<int>(m_frameArena));
+    for (int i = 0; i < count; ++i) parent[i] = i;
+
+    auto find = [&](int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]]; // Path halving
+            i = parent[i];
+        }
+        return i;
+    };
+
+    for (const Manifold& m : manifolds) {
+        if (m_bodies.isStatic[m.A] || m_bodies.isStatic[m.B]) continue;
+        int a = find(m.A);
+        int b = find(m.B);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    // Islands sleep only once every body in them has rested for long enough
+    FrameVector<float> islandSleepTime(count, std::numeric_limits<float>::infinity(), ArenaAllocator<float>(m_frameArena));
+    for (int i = 0; i < count; ++i) {
+        if (m_bodies.isStatic[i] || !m_bodies.awake[i]) continue;
+        int root = find(i);
+        if (root == i) m_stats.islands++;
+        islandSleepTime[root] = std::min(islandSleepTime[root], m_bodies.sleepTime[i]);
+    }
+
+    FrameVector<int> first(count, -1, ArenaAllocator<int>(m_frameArena));
+    FrameVector<int> last(count, -1, ArenaAllocator<int>(m_frameArena));
+
+    for (int i = 0; i < count; ++i) {
+
+        if (m_bodies.isStatic[i]) continue;
+        if (!m_bodies.awake[i]) { m_stats.sleepingBodies++; continue; }
+
+        int root = find(i);
+        if (islandSleepTime[root] < m_timeToSleep) continue;
+
+        if (first[root] < 0) first[root] = i;
+        else m_bodies.sleepNext[last[root]] = m_bodies.slot[i];
+        last[root] = i;
+
+        m_bodies.awake[i] = 0;
+        m_bodies.linearVelocity[i] = Vec2(0.0f, 0.0f);
+        m_bodies.angularVelocity[i] = 0.0f;
+
+        // Positional correction may have moved the body since the broadphase, cache its final resting bounds
+        physEng::worldSpace(m_bodies, i);
+        m_bodies.bounds[i] = physEng::worldBounds(m_bodies, i);
+
+        m_stats.sleepingBodies++;
+        m_sleepingGridDirty = true;
+
+    }
+
+    for (int root = 0; root < count; ++root) {
+        if (first[root] >= 0) m_bodies.sleepNext[last[root]] = m_bodies.slot[first[root]]; // Close the ring
+    }
+
+}
+
+void World::wakeIsland(int i) {
+
+    // Wakes body i and every body sleeping in the same island, by walking the island's ring
+
+    if (m_bodies.isStatic[i] || m_bodies.awake[i]) return;
+
+    const uint32_t start = m_bodies.slot[i];
+    uint32_t s = start;
+
+    do {
+        int k = m_bodies.indexOfSlot(s);
+        s = m_bodies.sleepNext[k];
+        m_bodies.awake[k] = 1;
+        m_bodies.sleepTime[k] = 0.0f;
+        m_bodies.sleepNext[k] = m_bodies.slot[k];
+    } while (s != start);
+
+    m_sleepingGridDirty = true;
+
+}
+
+void World::rebuildSleepingGrid() {
+
+    // Re-bakes the persistent grid of sleeping bodies, only needed when bodies fall asleep, wake, or are removed.
+    // The grid keeps its arrays between bakes, so islands sleeping and waking do not allocate once it has grown.
+
+    m_sleepingGrid.clear(persistentCellSize());
+    for (int i = 0; i < m_bodies.size(); ++i) {
+        if (m_bodies.isStatic[i] || m_bodies.awake[i]) continue;
+        m_sleepingGrid.insert(m_bodies.bounds[i], m_bodies.slot[i]);
+    }
+    m_sleepingGrid.bake();
+    m_sleepingGridDirty = false;
+
+}
+
+void World::rebuildStaticGrid() {
+
+    // Re-bakes the grid of static bodies, only needed when statics are added, removed or moved.
+    // Statics are transformed and bounded here, the broadphase never touches them again until the next rebuild.
+
+    m_staticGrid.clear(persistentCellSize());
+    for (int i = 0; i < m_bodies.size(); ++i) {
+        if (!m_bodies.isStatic[i]) continue;
+        physEng::worldSpace(m_bodies, i); // No-op unless flagged for update
+        m_bodies.bounds[i] = physEng::worldBounds(m_bodies, i);
+        m_staticGrid.insert(m_bodies.bounds[i], m_bodies.slot[i]);
+    }
+    m_staticGrid.bake();
+    m_staticGridDirty = false;
+
+}
+
+float World::persistentCellSize() const {
+
+    // Level 0 cell size of the static and sleeping grids: the grid backend's tuned size, so all three bucket alike,
+    // or the configured one with backends that have no cells
+
+    const float tuned = m_broadphase->cellSize();
+    return (tuned > 0.0f) ? tuned : m_gridConfig.cellSize;
+
+}
+
+void World::evictFreedSlots() {
+
+    // Drops the cached pair data of removed bodies. Their slots are recycled by the next bodies added, which would
+    // otherwise find the removed body's impulses or separating axes under the same slot pair. Run before the step's first cache lookup.
+
+    std::sort(m_freedSlots.begin(), m_freedSlots.end());
+    auto touchesFreed = [&](uint64_t key) {
+        return std::binary_search(m_freedSlots.begin(), m_freedSlots.end(), static_cast<uint32_t>(key >> 32)) ||
+               std::binary_search(m_freedSlots.begin(), m_freedSlots.end(), static_cast<uint32_t>(key));
+    };
+    m_contactCache.evict(touchesFreed);
+    m_axisCache.evict(touchesFreed);
+    m_freedSlots.clear();
+
+}
+
+bool World::wakeBody(BodyHandle handle) {
+
+    int i = m_bodies.indexOf(handle);
+    if (i < 0) return false;
+    wakeIsland(i);
+    return true;
+
+}
+
+bool World::applyImpulse(BodyHandle handle, const Vec2& impulse, const Vec2& worldPoint) {
+
+    // Applies an impulse at a world-space point, waking the body ( and its island ) first
+
+    int i = m_bodies.indexOf(handle);
+    if (i < 0) return false;
+
+    wakeIsland(i);
+    m_bodies.linearVelocity[i] += impulse * m_bodies.inverseMass[i];
+    m_bodies.angularVelocity[i] += vecMath::cross(worldPoint - m_bodies.position[i], impulse) * m_bodies.inverseInertia[i];
+    return true;
+
+}
+
+bool World::removeBody(BodyHandle handle) {
+
+    // Removes a body. Sleeping islands it belonged to or was supporting are woken first, so nothing is
+    // left asleep in mid air and no ring references the removed slot.
+
+    int i = m_bodies.indexOf(handle);
+    if (i < 0) return false;
+
+    wakeIsland(i);
+    for (int k = 0; k < m_bodies.size(); ++k) {
+        if (!m_bodies.isStatic[k] && !m_bodies.awake[k] && AABBintersection(m_bodies.bounds[k], m_bodies.bounds[i])) {
+            wakeIsland(k);
+        }
+    }
+
+    if (m_bodies.isStatic[i]) m_staticGridDirty = true;
+    m_freedSlots.push_back(m_bodies.slot[i]); // Its cached pairs are evicted at the start of the next step
+    m_bodies.removeAt(i);
+    return true;
+
+}
+
+void World::setSleepingEnabled(bool enabled) {
+
+    m_allowSleeping = enabled;
+    if (enabled) return;
+
+    for (int i = 0; i < m_bodies.size(); ++i) wakeIsland(i);
+
+}
+
+void World::updateVertices() {
+
+    // Materializes the world-space vertices lazy transforms skipped, e.g. before rendering
+
+    for (int i = 0; i < m_bodies.size(); ++i) physEng::worldSpace(m_bodies, i);
+
+}
+
+void World::setBroadphase(BroadphaseType type) {
+
+    if (type == m_broadphaseType) return;
+
+    m_broadphaseType = type;
+    switch (type) {
+        case BroadphaseType::Tree: m_broadphase = std::make_unique<partioning::TreeBroadphase>(); break;
+        case BroadphaseType::SweepAndPrune: m_broadphase = std::make_unique<partioning::SweepAndPrune>(); break;
+        default: m_broadphase = std::make_unique<partioning::GridBroadphase>(m_gridConfig); break;
+    }
+
+}